@@ -16,6 +16,9 @@
 //third-party LCD library
 //you can use any other library.
 #include "lcd_tb.h"
+//LCD framebuffer and text layout, text is sent to display in background
+#include "lcd_fb.h"
+#include "lcd_text.h"
 
 #include <avr/io.h>
 #include <util/delay.h>
@@ -33,7 +36,7 @@
 //Define preset numbers for  button 1 - 6. Any value you want ;)
 const char presetNumbers[6] = {0x23, 0x14, 0x66, 0x2, 0x0, 0x5};
 	
-#define	PRESET_NAME_MAX_SIZE 16 //as we have 16-chars dispay, set 16 as max preset name length
+#define	PRESET_NAME_MAX_SIZE 32 //names longer than 16-chars display are scrolled
 const char presetNameToPrint[PRESET_NAME_MAX_SIZE] = "Name not found";//String for peint preset name. Default - "Name not found"
 
 //last active preset button number
@@ -79,16 +82,16 @@ void updateLeds()
 		ledSetColor(presetButtonNumber, COLOR_RED, true);//now all changes done and we can send prepared data to leds
 }
 
+//Name field on the bottom line
+LcdTextField nameField;
+
 void updateScreen()
 {
 	//Usually guitar sound processors display preset numbers starting from 1, but internal number is still 0
-	//Convert integer to string 
-	LCDWriteIntXY(9, 0, presetNumbers[presetButtonNumber] + 1, 3);
+	lcdTextWriteNumber(9, 0, 3, presetNumbers[presetButtonNumber] + 1);
 	
-	//clear bottom string
-	LCDWriteStringXY(0, 1, "                ");
-	//print name
-	LCDWriteStringXY(0, 1, (const char*)presetNameToPrint);
+	//print name. Text is written to framebuffer, only changed characters are sent to display
+	lcdTextSetText(&nameField, presetNameToPrint);
 }	
 
 void processPresetSwitching(uint8_t buttonNum)
@@ -211,12 +214,15 @@ int main(void)
 	//third-party LCD library initialization
 	LCDInit(LS_ULINE);
 	LcdHideCursor();
+	lcdFbInit();
+	//bottom line shows names, long name is scrolled
+	lcdTextAddField(&nameField, 0, 1, LCD_FB_COLS, LCD_TEXT_LEFT);
 	
 	//register midi callback for SysEx messages
 	midiRegisterSysExCallback(sysExCallback);
 	
 	//put  "Preset # " to screen. It is a static title
-	LCDWriteStringXY(0, 0, "Preset # ");
+	lcdFbWriteStringXY(0, 0, "Preset # ");
 	
 	updateLeds();
 	updateScreen();
@@ -233,5 +239,7 @@ int main(void)
 			processButtonEvent(lastButtonEvent);
 			
 		midiRead();
+		lcdTextProcess();
+		lcdFbProcess();
     }
 }
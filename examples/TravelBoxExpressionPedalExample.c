@@ -37,9 +37,6 @@ void updateScreen()
 
 void expPedalsCallback(PedalNumber pedalNumber, uint8_t pedalPosition)
 {
-	//send control change message
-	midiSendControlChange(pedalCCNumbers[(uint8_t)pedalNumber], pedalPosition, MIDI_CHANNEL);
-	
 	//update local variable to print current value
 	pedalPositions[(uint8_t)pedalNumber] = pedalPosition;
 	updateScreen();
@@ -60,6 +57,16 @@ int main(void)
 	//compare it with previous value and process changes
 	expRegisterPedalChangePositionCallback(expPedalsCallback);
 	
+	//control change messages are sent by library. Fast pedal sweep is thinned out,
+	//so midi link is not overloaded and final pedal position is always sent
+	expSetPedalOutput(EXP_PEDAL1, EXP_OUTPUT_CC, pedalCCNumbers[0], MIDI_CHANNEL);
+	expSetPedalOutput(EXP_PEDAL2, EXP_OUTPUT_CC, pedalCCNumbers[1], MIDI_CHANNEL);
+	expSetPedalOutput(EXP_PEDAL_ONBOARD, EXP_OUTPUT_CC, pedalCCNumbers[2], MIDI_CHANNEL);
+	//at most 50 messages per second from each pedal
+	expSetPedalRateLimit(EXP_PEDAL1, 20);
+	expSetPedalRateLimit(EXP_PEDAL2, 20);
+	expSetPedalRateLimit(EXP_PEDAL_ONBOARD, 20);
+	
 	LCDWriteStringXY(0, 0,"P1: ");
 	LCDWriteStringXY(8, 0,"P2: ");
 	LCDWriteStringXY(0, 1,"P3: ");
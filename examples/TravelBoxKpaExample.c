@@ -16,9 +16,11 @@
 //third-party LCD library
 //you can use any other library.
 #include "lcd_tb.h"
+//LCD framebuffer and text layout, text is sent to display in background
+#include "lcd_fb.h"
+#include "lcd_text.h"
 
 #include <avr/io.h>
-#include <util/delay.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -33,13 +35,9 @@ const char presetNumbers[6] = {0x23, 0x14, 0x66, 0x2, 0x0, 0x5};
 //last active preset button number
 uint8_t presetButtonNumber = 0;
 
-//Kpa connection status
-bool kpaConnected = false;
-//Kpa state
-uint16_t kpaMode = 0;//Kemper main mode.  (0=BROWSE/1=PERFORM)
 
 //Kpa rig and perfomance name
-#define	NAME_MAX_SIZE 16 //as we have 16-chars display, set 16 as max preset name length
+#define	NAME_MAX_SIZE 32 //names longer than 16-chars display are scrolled
 char kpaRigName[NAME_MAX_SIZE] = "No rig";
 char kpaPerformanceName[NAME_MAX_SIZE] = "No perfom";
 
@@ -56,7 +54,18 @@ KpaParamAddress stompParamNumbers[6] = {KPA_PARAM_STOMP_A_ON_OFF
 #define STOMP_OFF	0x0000
 #define STOMP_ON	0x0001
 
-uint16_t stompActualValue[6] = {STOMP_OFF, STOMP_OFF, STOMP_OFF, STOMP_OFF, STOMP_OFF, STOMP_OFF};
+//Stomps state and main mode are kept in KPA state mirror, see kpaStateWatch()
+//Kemper main mode (0=BROWSE/1=PERFORM)
+#define KPA_MODE_BROWSE 0x0000
+
+uint16_t getStompValue(uint8_t stompNum)
+{
+	uint16_t value;
+	//Value is unknown until KPA sends it
+	if(!kpaStateGet(stompParamNumbers[stompNum], &value))
+		value = STOMP_OFF;
+	return value;
+}
 
 void updateLeds()
 {
@@ -69,7 +78,7 @@ void updateLeds()
 	//Green led show stompbox active state
 	for (i = 0; i < sizeof(stompParamNumbers)/sizeof(stompParamNumbers[0]); ++i)
 	{
-		if(stompActualValue[i] == STOMP_ON)
+		if(getStompValue(i) == STOMP_ON)
 			ledSetColor(i + 6, COLOR_GREEN, false);//Active stomp is green led. Stomps leds numbers starts from 6
 	}
 	
@@ -77,22 +86,24 @@ void updateLeds()
 	ledSetColor(presetButtonNumber, COLOR_RED, true);//now all changes done and we can send prepared data to leds
 }
 
+//Name field on the bottom line
+LcdTextField nameField;
+
 void updateScreen()
 {
+	uint16_t kpaMode = KPA_MODE_BROWSE;
+	kpaStateGet(KPA_PARAM_SELECTED_MAIN_MODE, &kpaMode);
 
 	//Usually guitar sound processors display preset numbers starting from 1, but internal number is still 0
-	//Print number
-	LCDWriteIntXY(9, 0, presetNumbers[presetButtonNumber] + 1, 3);
+	lcdTextWriteNumber(9, 0, 3, presetNumbers[presetButtonNumber] + 1);
 	
-	//clear bottom string
-	LCDWriteStringXY(0, 1, "                ");
-	//print string
-	if(kpaMode == 0)
+	//print string. Text is written to framebuffer, only changed characters are sent to display
+	if(kpaMode == KPA_MODE_BROWSE)
 		//Browse mode. Show rig name
-		LCDWriteStringXY(0, 1, (const char*)kpaRigName);
+		lcdTextSetText(&nameField, kpaRigName);
 	else
 		//Performance mode. Show performance name
-		LCDWriteStringXY(0, 1, (const char*)kpaPerformanceName);
+		lcdTextSetText(&nameField, kpaPerformanceName);
 }
 
 void processPresetSwitching(uint8_t buttonNum)
@@ -113,14 +124,12 @@ void processPresetSwitching(uint8_t buttonNum)
 void processStompboxSwitching(uint8_t buttonNum)
 {
 	//invert stompbox state
-	if(stompActualValue[buttonNum] == STOMP_OFF)
-		stompActualValue[buttonNum] = STOMP_ON;
-	else
-		stompActualValue[buttonNum] = STOMP_OFF;
+	uint16_t value = (getStompValue(buttonNum) == STOMP_OFF) ? STOMP_ON : STOMP_OFF;
 
 	//Send message to change stomp state
-	kpaSendSingleParameterChange(stompParamNumbers[buttonNum], (uint16_t)stompActualValue[buttonNum]);
-	updateLeds();
+	kpaSendSingleParameterChange(stompParamNumbers[buttonNum], value);
+	//KPA does not echo changes sent by us, so update state mirror. LEDs are updated in main loop
+	kpaStateSet(stompParamNumbers[buttonNum], value);
 }
 
 
@@ -140,16 +149,25 @@ void processButtonEvent(ButtonEvent buttonEvent)
 	
 }
 
-//implement helper for IA states processing
-void parseIaStates(KpaParamAddress addr, uint8_t* sysexData)
+//refresh only LEDs and screen parts which depend on changed KPA parameters
+void processKpaStateChanges()
 {
 	uint8_t i;
-	for(i = 0; i < 6; ++i)
+	bool ledsChanged = false;
+	
+	if(!kpaStateAnyChanged())
+		return;
+	
+	for(i = 0; i < sizeof(stompParamNumbers)/sizeof(stompParamNumbers[0]); ++i)
 	{
-		if(addr == stompParamNumbers[i])//find IA address in array
-			stompActualValue[i] = kpaGetSingleParameterValue(sysexData);//set corresponding IA to valid state
+		if(kpaStateTakeChanged(stompParamNumbers[i]))
+			ledsChanged = true;
 	}
-	updateLeds();
+	if(ledsChanged)
+		updateLeds();
+	
+	if(kpaStateTakeChanged(KPA_PARAM_SELECTED_MAIN_MODE))
+		updateScreen();
 }
 
 //create callback for income sysex messages from KPA
@@ -157,39 +175,20 @@ void sysExCallback(uint16_t length)
 {
 	uint8_t* sysEx;//pointer to SysEx payload data
 	sysEx = midiGetLastSysExData();
+	//KPA sends IA states and main mode as single parameter change. 
+	//Watched parameters are stored in state mirror, changes are processed in main loop
+	if(kpaProcessSysEx(sysEx))
+		return;
+	
 	//get function code
 	uint8_t function = kpaGetFunction(sysEx);
 	
-	//address from message
-	KpaParamAddress addr;
 	switch(function)
 	{
-		case KPA_FUNCTION_SINGLE_PARAMETER_CHANGE : //KPA sends IA states and main mode as single parameter change
-			addr = kpaGetParamAddress(sysEx);
-			switch (addr)
-			{
-				case KPA_PARAM_SELECTED_MAIN_MODE : //parse main mode 
-					kpaMode = kpaGetSingleParameterValue(sysEx);
-					updateScreen();
-					break;
-				
-				case KPA_PARAM_STOMP_A_ON_OFF : //parse all stomboxes state	
-				case KPA_PARAM_STOMP_B_ON_OFF :
-				case KPA_PARAM_STOMP_C_ON_OFF :
-				case KPA_PARAM_STOMP_D_ON_OFF :
-				case KPA_PARAM_REVERB_ON_OFF_CUTS_TAIL :
-				case KPA_PARAM_DELAY_ON_OFF_CUTS_TAIL :
-					parseIaStates(addr, sysEx);
-				break;
-				
-				default: break;
-			}
-		break;
-		
 		case KPA_FUNCTION_STRING_PARAMETER_CHANGE : //Rig Name passed as STRING_PARAMETER_CHANGE
 			if(kpaGetParamAddress(sysEx) == KPA_PARAM_RIG_NAME)
 			{
-				kpaGetStringParameter(kpaRigName, NAME_MAX_SIZE, sysEx);//Fill rig name. We don't need more than 16 chars due the display limitation
+				kpaGetStringParameter(kpaRigName, NAME_MAX_SIZE, sysEx);//Fill rig name. Long name is scrolled on display
 				LOG(SEV_TRACE, "Rig name :%s", kpaRigName); 
 				updateScreen();
 			}
@@ -198,7 +197,7 @@ void sysExCallback(uint16_t length)
 		case KPA_FUNCTION_EXTENDED_STRING_PARAMETER_CHANGE : //Performance Name passed as EXTENDED_STRING_PARAMETER_CHANGE
 			if(kpaGetParamExtAddress(sysEx) == KPA_PARAM_EXT_PERFORMANCE_NAME)
 			{
-				kpaGetExtStringParameter(kpaPerformanceName, NAME_MAX_SIZE, sysEx);//Fill performance name. We don't need more than 16 chars due the display limitation
+				kpaGetExtStringParameter(kpaPerformanceName, NAME_MAX_SIZE, sysEx);//Fill performance name. Long name is scrolled on display
 				LOG(SEV_TRACE, "Perf name :%s", kpaPerformanceName); 
 				updateScreen();
 			}
@@ -206,41 +205,41 @@ void sysExCallback(uint16_t length)
 	}
 }
 
+//KPA connection manager callback. Connection is established and kept alive by kpaConnectionProcess()
+void kpaConnectionChanged(bool connected)
+{
+	if(connected)
+	{
+		LOG(SEV_TRACE, "KPA connected"); 
+		//KPA sends full parameters set after connection, names will replace this text
+		lcdTextSetText(&nameField, "KPA Connected");
+	}
+	else
+	{
+		LOG(SEV_TRACE, "KPA lost"); 
+		lcdTextSetText(&nameField, "KPA not connected");
+	}
+}
+
 //connection initialization
 void initConnectionToKpa()
 {
-	if(kpaConnected)
-		return;
-	LCDWriteStringXY(0, 1, "KPA Connected");
-	_delay_ms(500);
-	kpaConnected = true;
-	//If you want to KPA show a popup with the your floorboard name when the first beacon message received
-	//you should send string change request with KPA_PARAM_FLOORBOARD_NAME address and board name
-	kpaSendStringParameterChange(KPA_PARAM_FLOORBOARD_NAME, "My first midi board");
-	
-	_delay_ms(100);
-	//Then "beacon" message should be send to KPA to enable sending changes.
+	//"beacon" message is sent to KPA to enable sending changes.
 	//For details see kpaSendBeacon(...) function description in kpa.h
 	
 	//First prepare flags. See flags description in kpa.h
-	uint8_t beaconFlags = KPA_BEACON_FLAG_INIT
-						| KPA_BEACON_FLAG_SYSEX //library works only with SysEx
-						//In this simple example we will not process communication issue,
-						//so we disable to send FE ans sensing by set KPA_BEACON_FLAG_NOFE and KPA_BEACON_FLAG_NOCTR.
-						//But it is not good practice in real life.
-						//In real life you should to keep track of the connection is good
-						//by monitoring "Sensing" message which comes about every 500ms
-						//as long as the time lease is valid
+	uint8_t beaconFlags = KPA_BEACON_FLAG_SYSEX //library works only with SysEx
+						//KPA stops sending FE when protocol is initiated. 
+						//Connection is tracked by "Sensing" SysEx message which comes about every 500ms
+						//as long as the time lease is valid. Connection manager renews time lease.
 						| KPA_BEACON_FLAG_NOFE
-						| KPA_BEACON_FLAG_NOCTR
 						| KPA_BEACON_FLAG_TUNEMODE;//tuner will send only in tuner mode
 	
-	kpaSendBeacon(2			//Set number. I want to use SET2, its contain performance and rig names inter alia.
+	kpaConnectionStart(2	//Set number. I want to use SET2, its contain performance and rig names inter alia.
 				,beaconFlags//Flags
-				,127);		//Send changes forever. Possible it is overhead, but it is a simplest way to communication, no need to resend beacon
-	LOG(SEV_TRACE, "Send beacon"); 
-	
-	updateScreen();
+				//KPA shows a popup with the your floorboard name when the first beacon message received
+				,"My first midi board"
+				,kpaConnectionChanged);
 }
 
 const char stringSev[] PROGMEM = "TRACE: ";
@@ -253,16 +252,25 @@ int main(void)
 	//third-party LCD library initialization
 	LCDInit(LS_ULINE);
 	LcdHideCursor();
+	lcdFbInit();
+	//bottom line shows names, long name is scrolled
+	lcdTextAddField(&nameField, 0, 1, LCD_FB_COLS, LCD_TEXT_LEFT);
 	
 	//KPA send MIDI Active Sensing real time message 0xFE.
-	//As soon as we can see it, we able to establish bi-directorial connection with KPA
-	midiRegisterActiveSenseCallback(initConnectionToKpa);
+	//As soon as we can see it, connection manager establishes bi-directorial connection with KPA
+	initConnectionToKpa();
 	
 	//register midi callback for SysEx messages
 	midiRegisterSysExCallback(sysExCallback);
 	
+	//watch stomps state and main mode in KPA state mirror
+	uint8_t i;
+	for(i = 0; i < sizeof(stompParamNumbers)/sizeof(stompParamNumbers[0]); ++i)
+		kpaStateWatch(stompParamNumbers[i]);
+	kpaStateWatch(KPA_PARAM_SELECTED_MAIN_MODE);
+	
 	//put  "Preset # " to screen. It is a static title
-	LCDWriteStringXY(0, 0, "Preset # ");
+	lcdFbWriteStringXY(0, 0, "Preset # ");
 	
 	updateLeds();
 	updateScreen();
@@ -280,5 +288,9 @@ int main(void)
 			processButtonEvent(lastButtonEvent);
 		
 		midiRead();
+		kpaConnectionProcess();
+		processKpaStateChanges();
+		lcdTextProcess();
+		lcdFbProcess();
 	}
 }
\ No newline at end of file
@@ -11,7 +11,7 @@
 
 #include "unique_id.h"
 #include "lcd_tb.h"
-#include <util/delay.h>
+#include <avr/interrupt.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -32,7 +32,7 @@ uint64_t swapByteOrder(uint64_t value)
 //this can be defined in project settings, makefile or provided through -D compiler option in command line
 #define GLOBALY_DEFINED_USER_ID 0x0102030405060708
 
-#define ID_BYTES 8//DS2411 ID contain 8 bytes. 7 bytes data + 1 byte CRC
+#define ID_BYTES UNIQ_ID_SIZE//DS2411 ID contain 8 bytes. 7 bytes data + 1 byte CRC
 uint8_t idBuffer[ID_BYTES];//Buffer for data from DS2411
 char idStr[ID_BYTES*2+1];//Buffer for string representation of ID
 
@@ -43,14 +43,17 @@ char idStr[ID_BYTES*2+1];//Buffer for string representation of ID
 	//LCD initialization
 	LCDInit(LS_ULINE);
 
-	//1-wire interface initialization
+	//1-wire interface initialization. ID cached in EEPROM is loaded here.
+	//On first run there is no cached ID, so it is read from DS2411 in background
 	initUniqId();
-	
-	//small delay... just in case :)
-	_delay_ms(10);
+	sei();
+
+	//wait only if there is no cached ID yet. Next boots take ID from EEPROM immediately
+	while(uniqIdGetStatus() == UNIQ_ID_UNKNOWN)
+		uniqIdProcess();
 
-	//read unique ID from DS2411. If successfully - print in on screen
-	if(uniqIdGet(idBuffer))
+	//If ID is available - print in on screen
+	if(uniqIdGetCached(idBuffer))
 	{
 		for(i = 0; i < ID_BYTES; ++i)
 			sprintf(idStr+(i*2), "%02x", idBuffer[i]);
@@ -77,6 +80,18 @@ char idStr[ID_BYTES*2+1];//Buffer for string representation of ID
 	}
 
 	LCDWriteStringXY(0,1, "ID matched!");//ID matched, start firmware
+	
+	//EEPROM may be copied from another device, so check cached ID with DS2411 in background
+	bool verifying = uniqIdGetStatus() == UNIQ_ID_CACHED && uniqIdStartVerify();
+	
 	//Start to implement your firmware behavior here
+	while(1)
+	{
+		uniqIdProcess();
+		if(verifying && (uniqIdGetStatus() == UNIQ_ID_UPDATED || uniqIdGetStatus() == UNIQ_ID_NOT_AVAILABLE))
+		{
+			LCDWriteStringXY(0,1, "ID not matched!");
+			return 0;//cached ID was not confirmed by DS2411
+		}
+	}
  }
-
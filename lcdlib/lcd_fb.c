@@ -0,0 +1,289 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	lcd_fb.c
+ * 
+ * @brief	Shadow framebuffer for HD44780 LCD
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "lcd_fb.h"
+#include "timer.h"
+
+#include <avr/pgmspace.h>
+#include <stddef.h>
+
+#define LCD_FB_DIRTY_BYTES ((LCD_FB_COLS + 7) >> 3)
+
+//Address of display cursor is unknown
+#define LCD_FB_CURSOR_UNKNOWN 0xFF
+
+static char frame[LCD_FB_ROWS][LCD_FB_COLS];
+static volatile uint8_t dirty[LCD_FB_ROWS][LCD_FB_DIRTY_BYTES];
+static volatile bool anyDirty;
+
+//custom characters uploads, glyphs are in PROGMEM
+static const uint8_t* volatile glyphs[LCD_FB_GLYPH_SLOTS];
+static volatile uint8_t glyphsPending;
+static const uint8_t* glyphUploading;
+static uint8_t glyphSlot;
+static uint8_t glyphRow;
+#ifdef LCD_WRITE_ONLY
+static bool flushRegistered;
+#endif
+
+//write position
+static uint8_t posX;
+static uint8_t posY;
+
+//background flush state. Accessed only from flushStep()
+static uint8_t scanX;
+static uint8_t scanY;
+static uint8_t cursorX = LCD_FB_CURSOR_UNKNOWN;
+static uint8_t cursorY;
+
+static void setCell(uint8_t x, uint8_t y, char c)
+{
+	if(frame[y][x] == c)
+		return;
+	
+	//character is written before dirty flag, so interrupt never sends old one and clears flag
+	frame[y][x] = c;
+	dirty[y][x >> 3] |= (1 << (x & 0x07));
+	anyDirty = true;
+}
+
+//Find next changed cell starting from last sent one
+static bool findDirty()
+{
+	uint8_t i;
+	
+	for(i = 0; i < LCD_FB_COLS * LCD_FB_ROWS; ++i)
+	{
+		if(dirty[scanY][scanX >> 3] & (1 << (scanX & 0x07)))
+			return true;
+		
+		if(++scanX == LCD_FB_COLS)
+		{
+			scanX = 0;
+			if(++scanY == LCD_FB_ROWS)
+				scanY = 0;
+		}
+	}
+	return false;
+}
+
+//Upload one byte of lowest pending glyph. First byte is CGRAM address command
+static void uploadGlyph()
+{
+	uint8_t slot = glyphSlot;
+	
+	if(glyphRow == 0)
+	{
+		slot = 0;
+		while(!(glyphsPending & (1 << slot)))
+			++slot;
+		
+		glyphSlot = slot;
+		glyphUploading = glyphs[slot];
+		LCDCmd(0b01000000 | (slot << 3));
+		cursorX = LCD_FB_CURSOR_UNKNOWN;//address counter points to CGRAM now
+		++glyphRow;
+		return;
+	}
+	
+	LCDData(pgm_read_byte(glyphUploading + glyphRow - 1));
+	if(++glyphRow > LCD_FB_GLYPH_HEIGHT)
+	{
+		glyphRow = 0;
+		if(glyphs[slot] == glyphUploading)//slot is not reassigned during upload
+			glyphsPending &= ~(1 << slot);
+	}
+}
+
+//Send up to LCD_FB_BYTES_PER_TICK bytes of changed glyphs and cells
+static void flushStep()
+{
+	uint8_t budget = LCD_FB_BYTES_PER_TICK;
+	
+	//Display is not ready while initialized or executing clear command, see LCD_WRITE_ONLY in lcd_tb.h.
+	//This module sends only data and address commands, so in write-only mode next byte of the tick 
+	//waits in LCDByte() for at most one short execution slot (50us), never for clear or home
+	if((!anyDirty && !glyphsPending) || !LCDIsReady())
+		return;
+	
+	//glyphs go first, so cells which show them are sent after upload
+	while(budget && glyphsPending)
+	{
+		--budget;
+		uploadGlyph();
+	}
+	
+	if(glyphsPending)
+		return;
+	
+	while(budget)
+	{
+		if(!findDirty())
+		{
+			anyDirty = false;
+			return;
+		}
+		
+		--budget;
+		if(scanX != cursorX || scanY != cursorY)
+		{
+			//consecutive cells are sent without address command, display increments address itself
+			LCDGotoXY(scanX, scanY);
+			cursorX = scanX;
+			cursorY = scanY;
+			continue;
+		}
+		
+		dirty[scanY][scanX >> 3] &= ~(1 << (scanX & 0x07));
+		LCDData(frame[scanY][scanX]);
+		if(++cursorX == LCD_FB_COLS)
+			cursorX = LCD_FB_CURSOR_UNKNOWN;//address runs to invisible area or to next line
+	}
+}
+
+#ifdef LCD_WRITE_ONLY
+//Write-only mode never waits for display, so bytes are sent from timer interrupt
+static void flushCallback()
+{
+	flushStep();
+}
+#endif
+
+void lcdFbProcess()
+{
+#ifndef LCD_WRITE_ONLY
+	//busy flag polling takes time, so it is kept out of interrupts
+	flushStep();
+#endif
+}
+
+bool lcdFbInit()
+{
+	uint8_t x;
+	uint8_t y;
+	
+	for(y = 0; y < LCD_FB_ROWS; ++y)
+	{
+		for(x = 0; x < LCD_FB_COLS; ++x)
+		{
+			frame[y][x] = ' ';
+			dirty[y][x >> 3] |= (1 << (x & 0x07));
+		}
+	}
+	anyDirty = true;
+	posX = 0;
+	posY = 0;
+	
+#ifdef LCD_WRITE_ONLY
+	if(!flushRegistered)
+		flushRegistered = timerRegisterMsCallback(flushCallback);
+	
+	return flushRegistered;
+#else
+	return true;
+#endif
+}
+
+void lcdFbClear()
+{
+	uint8_t y;
+	
+	for(y = 0; y < LCD_FB_ROWS; ++y)
+		lcdFbClearLine(0, y);
+	
+	posX = 0;
+	posY = 0;
+}
+
+void lcdFbClearLine(uint8_t x, uint8_t y)
+{
+	if(y >= LCD_FB_ROWS)
+		return;
+	
+	for(; x < LCD_FB_COLS; ++x)
+		setCell(x, y, ' ');
+}
+
+void lcdFbGotoXY(uint8_t x, uint8_t y)
+{
+	posX = x;
+	posY = y;
+}
+
+void lcdFbPutChar(char c)
+{
+	if(posX < LCD_FB_COLS && posY < LCD_FB_ROWS)
+		setCell(posX, posY, c);
+	
+	++posX;
+}
+
+void lcdFbWriteString(const char* str)
+{
+	while(*str != '\0')
+		lcdFbPutChar(*str++);
+}
+
+void lcdFbWriteField(const char* str, uint8_t width)
+{
+	while(width && *str != '\0')
+	{
+		lcdFbPutChar(*str++);
+		--width;
+	}
+	
+	while(width--)
+		lcdFbPutChar(' ');
+}
+
+char lcdFbGetChar(uint8_t x, uint8_t y)
+{
+	if(x >= LCD_FB_COLS || y >= LCD_FB_ROWS)
+		return ' ';
+	
+	return frame[y][x];
+}
+
+uint8_t lcdFbGetShownGlyphs()
+{
+	uint8_t mask = 0;
+	uint8_t x;
+	uint8_t y;
+	
+	for(y = 0; y < LCD_FB_ROWS; ++y)
+	{
+		for(x = 0; x < LCD_FB_COLS; ++x)
+		{
+			if((uint8_t)frame[y][x] < LCD_FB_GLYPH_SLOTS)
+				mask |= (1 << (uint8_t)frame[y][x]);
+		}
+	}
+	return mask;
+}
+
+void lcdFbLoadGlyph(uint8_t slot, const uint8_t* glyph)
+{
+	if(slot >= LCD_FB_GLYPH_SLOTS)
+		return;
+	
+	glyphs[slot] = glyph;
+	glyphsPending |= (1 << slot);
+}
+
+bool lcdFbIsSynced()
+{
+	return !anyDirty && !glyphsPending;
+}
+
+void lcdFbFlush()
+{
+	while(!lcdFbIsSynced())
+		lcdFbProcess();
+}
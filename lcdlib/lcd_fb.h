@@ -0,0 +1,130 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	lcd_fb.h
+ * 
+ * @brief	Shadow framebuffer for HD44780 LCD. Text is written to RAM, only changed cells are sent to display.
+ *			With LCD_WRITE_ONLY (see lcd_tb.h) cells are pushed from Timer2 millisecond interrupt, 
+ *			LCD_FB_BYTES_PER_TICK bytes per tick, and main loop never waits for display. In busy flag mode cells are sent
+ *			by lcdFbProcess() from main loop, because busy flag polling must not be done in interrupt.
+ *			After lcdFbInit() all text output should be done by this module only, see lcdFbFlush()
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+
+#ifndef lcd_fb_h_
+#define lcd_fb_h_
+
+#include "lcd_tb.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Framebuffer size follows LCD type selection in lcd_tb.h
+#if defined (LCD_TYPE_204)
+#	define LCD_FB_COLS 20
+#	define LCD_FB_ROWS 4
+#elif defined (LCD_TYPE_202)
+#	define LCD_FB_COLS 20
+#	define LCD_FB_ROWS 2
+#elif defined (LCD_TYPE_164)
+#	define LCD_FB_COLS 16
+#	define LCD_FB_ROWS 4
+#else
+#	define LCD_FB_COLS 16
+#	define LCD_FB_ROWS 2
+#endif
+
+//Maximum bytes sent to display per millisecond tick or per lcdFbProcess() call. 
+//With LCD_WRITE_ONLY each byte after the first one waits up to 50us execution time of previous 
+//byte in interrupt, so N bytes per tick cost up to (N-1)*50us of interrupt time. 
+//16x2 redraw with address commands is about 34 bytes, 17ms with 2 bytes per tick
+#ifndef LCD_FB_BYTES_PER_TICK
+#	define LCD_FB_BYTES_PER_TICK 2
+#endif
+
+//HD44780 custom characters
+#define LCD_FB_GLYPH_SLOTS 8
+#define LCD_FB_GLYPH_HEIGHT 8
+
+/*
+ * @brief	Fill framebuffer with spaces and start background flush. Call it after LCDInit()
+ * @return	false if there is no free timer callback slot
+ */
+bool lcdFbInit();
+
+/*
+ * @brief	Send changed cells in busy flag mode. Should be invoked in main loop.
+ *			Does nothing with LCD_WRITE_ONLY, cells are sent from timer interrupt
+ */
+void lcdFbProcess();
+
+/*
+ * @brief	Fill framebuffer with spaces
+ */
+void lcdFbClear();
+
+/*
+ * @brief	Fill line from column x to the end with spaces
+ */
+void lcdFbClearLine(uint8_t x, uint8_t y);
+
+/*
+ * @brief	Set framebuffer write position
+ */
+void lcdFbGotoXY(uint8_t x, uint8_t y);
+
+/*
+ * @brief	Put character to write position and move position right. Characters out of line are dropped.
+ *			Cell is marked for sending only if character is changed. Codes 0..7 are custom characters
+ */
+void lcdFbPutChar(char c);
+
+/*
+ * @brief	Put string to write position
+ */
+void lcdFbWriteString(const char* str);
+
+/*
+ * @brief	Put string and fill rest of the field with spaces, so previous longer text is erased 
+ *			without whole line redraw
+ * @param	width -	field width
+ */
+void lcdFbWriteField(const char* str, uint8_t width);
+
+/*
+ * @brief	Get character from framebuffer
+ */
+char lcdFbGetChar(uint8_t x, uint8_t y);
+
+/*
+ * @brief	Get custom characters used by framebuffer content
+ * @return	bit N is set if character code N is shown in any cell
+ */
+uint8_t lcdFbGetShownGlyphs();
+
+/*
+ * @brief	Upload custom character in background before pending cells. Cells which show this slot 
+ *			are changed on display at once. See also lcd_glyph.h
+ * @param	slot -	custom character code, 0..7
+ * @param	glyph -	LCD_FB_GLYPH_HEIGHT rows in PROGMEM, 5 low bits of each row are used
+ */
+void lcdFbLoadGlyph(uint8_t slot, const uint8_t* glyph);
+
+/*
+ * @brief	Check if all framebuffer changes are sent to display
+ */
+bool lcdFbIsSynced();
+
+/*
+ * @brief	Wait until all changes are sent. Use it before direct LCD access, e.g. custom characters loading
+ */
+void lcdFbFlush();
+
+#define lcdFbWriteStringXY(x, y, str) do{	\
+	lcdFbGotoXY(x, y);						\
+	lcdFbWriteString(str);					\
+}while(0)
+
+#endif /* lcd_fb_h_ */
@@ -0,0 +1,216 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	lcd_glyph.c
+ * 
+ * @brief	Custom characters manager and built-in glyph sets
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "lcd_glyph.h"
+
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//Big digits segments
+enum
+{
+	BIG_UPPER = 0
+	,BIG_LOWER
+	,BIG_BOTH
+	,BIG_SEGMENTS_NUM
+};
+
+static const uint8_t bigSegments[BIG_SEGMENTS_NUM][LCD_FB_GLYPH_HEIGHT] PROGMEM = 
+{
+	{0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00}
+	,{0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F}
+	,{0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x1F, 0x1F, 0x1F}
+};
+
+//Digit cells, top row then bottom row
+#define B_U BIG_UPPER
+#define B_L BIG_LOWER
+#define B_B BIG_BOTH
+#define B_F 0x80 //full block
+#define B_S 0x81 //space
+
+static const uint8_t bigDigits[10][LCD_GLYPH_BIG_DIGIT_WIDTH * LCD_GLYPH_BIG_DIGIT_HEIGHT] PROGMEM = 
+{
+	{B_F, B_U, B_F,		B_F, B_L, B_F}
+	,{B_U, B_F, B_S,	B_L, B_F, B_L}
+	,{B_B, B_B, B_F,	B_F, B_L, B_L}
+	,{B_U, B_B, B_F,	B_L, B_L, B_F}
+	,{B_F, B_L, B_F,	B_S, B_S, B_F}
+	,{B_F, B_B, B_B,	B_L, B_L, B_F}
+	,{B_F, B_B, B_B,	B_F, B_L, B_F}
+	,{B_U, B_U, B_F,	B_S, B_S, B_F}
+	,{B_F, B_B, B_F,	B_F, B_L, B_F}
+	,{B_F, B_B, B_F,	B_L, B_L, B_F}
+};
+
+//Bar graph cells with 1..4 filled columns, 5 columns is full block
+static const uint8_t barSegments[LCD_GLYPH_CELL_STEPS - 1][LCD_FB_GLYPH_HEIGHT] PROGMEM = 
+{
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10}
+	,{0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18}
+	,{0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C}
+	,{0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E}
+};
+
+//Needle at column 0..4 of cell
+static const uint8_t needleSegments[LCD_GLYPH_CELL_STEPS][LCD_FB_GLYPH_HEIGHT] PROGMEM = 
+{
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10}
+	,{0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08}
+	,{0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}
+	,{0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02}
+	,{0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01}
+};
+
+//Resident glyphs and their last use time
+static const uint8_t* slots[LCD_FB_GLYPH_SLOTS];
+static uint8_t slotsUseTime[LCD_FB_GLYPH_SLOTS];
+static uint8_t useTime;
+
+uint8_t lcdGlyphGet(const uint8_t* glyph)
+{
+	uint8_t oldest = LCD_FB_GLYPH_SLOTS;
+	uint8_t oldestAge = 0;
+	uint8_t age;
+	uint8_t shown;
+	uint8_t i;
+	
+	++useTime;
+	for(i = 0; i < LCD_FB_GLYPH_SLOTS; ++i)
+	{
+		if(slots[i] == glyph)
+		{
+			slotsUseTime[i] = useTime;
+			return i;
+		}
+	}
+	
+	//slots shown on screen are pinned, reload would change their cells
+	shown = lcdFbGetShownGlyphs();
+	for(i = 0; i < LCD_FB_GLYPH_SLOTS; ++i)
+	{
+		if(shown & (1 << i))
+			continue;
+		
+		//empty slot is the oldest one
+		age = (slots[i] == NULL) ? 0xFF : (uint8_t)(useTime - slotsUseTime[i]);
+		if(oldest == LCD_FB_GLYPH_SLOTS || age > oldestAge)
+		{
+			oldestAge = age;
+			oldest = i;
+		}
+	}
+	
+	if(oldest == LCD_FB_GLYPH_SLOTS)
+		return LCD_GLYPH_UNAVAILABLE;
+	
+	slots[oldest] = glyph;
+	slotsUseTime[oldest] = useTime;
+	lcdFbLoadGlyph(oldest, glyph);
+	return oldest;
+}
+
+void lcdGlyphReset()
+{
+	uint8_t i;
+	
+	for(i = 0; i < LCD_FB_GLYPH_SLOTS; ++i)
+		slots[i] = NULL;
+}
+
+void lcdGlyphDrawBigDigit(uint8_t x, uint8_t y, uint8_t digit)
+{
+	uint8_t row;
+	uint8_t col;
+	uint8_t cell;
+	const uint8_t* cells = bigDigits[digit % 10];
+	
+	for(row = 0; row < LCD_GLYPH_BIG_DIGIT_HEIGHT; ++row)
+	{
+		lcdFbGotoXY(x, y + row);
+		for(col = 0; col < LCD_GLYPH_BIG_DIGIT_WIDTH; ++col)
+		{
+			cell = pgm_read_byte(cells++);
+			if(cell == B_F)
+				lcdFbPutChar(LCD_GLYPH_FULL_BLOCK);
+			else if(cell == B_S)
+				lcdFbPutChar(' ');
+			else
+				lcdFbPutChar(lcdGlyphGet(bigSegments[cell]));
+		}
+	}
+}
+
+void lcdGlyphDrawBigNumber(uint8_t x, uint8_t y, uint16_t value, uint8_t digits)
+{
+	uint8_t row;
+	uint8_t col;
+	bool units = true;
+	
+	x += (digits - 1) * (LCD_GLYPH_BIG_DIGIT_WIDTH + 1);
+	while(digits--)
+	{
+		//units digit is always drawn, so zero is shown
+		if(value || units)
+		{
+			lcdGlyphDrawBigDigit(x, y, value % 10);
+			value /= 10;
+			units = false;
+		}
+		else
+		{
+			for(row = 0; row < LCD_GLYPH_BIG_DIGIT_HEIGHT; ++row)
+			{
+				lcdFbGotoXY(x, y + row);
+				for(col = 0; col < LCD_GLYPH_BIG_DIGIT_WIDTH; ++col)
+					lcdFbPutChar(' ');
+			}
+		}
+		x -= LCD_GLYPH_BIG_DIGIT_WIDTH + 1;
+	}
+}
+
+void lcdGlyphDrawBar(uint8_t x, uint8_t y, uint8_t width, uint8_t value)
+{
+	lcdFbGotoXY(x, y);
+	while(width--)
+	{
+		if(value >= LCD_GLYPH_CELL_STEPS)
+		{
+			lcdFbPutChar(LCD_GLYPH_FULL_BLOCK);
+			value -= LCD_GLYPH_CELL_STEPS;
+		}
+		else if(value)
+		{
+			lcdFbPutChar(lcdGlyphGet(barSegments[value - 1]));
+			value = 0;
+		}
+		else
+		{
+			lcdFbPutChar(' ');
+		}
+	}
+}
+
+void lcdGlyphDrawNeedle(uint8_t x, uint8_t y, uint8_t width, uint8_t position)
+{
+	uint8_t cell = position / LCD_GLYPH_CELL_STEPS;
+	uint8_t i;
+	
+	lcdFbGotoXY(x, y);
+	for(i = 0; i < width; ++i)
+	{
+		if(i == cell)
+			lcdFbPutChar(lcdGlyphGet(needleSegments[position - cell * LCD_GLYPH_CELL_STEPS]));
+		else
+			lcdFbPutChar(' ');
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	lcd_glyph.h
+ * 
+ * @brief	Custom characters manager. Glyphs are kept in PROGMEM and uploaded to 8 CGRAM slots on demand,
+ *			least recently used slot which is not shown in framebuffer is replaced. 
+ *			Resident glyphs are not uploaded again. Up to 8 different glyphs can be on screen at once.
+ *			Built-in glyph sets: big 2-line digits, horizontal bar graph and tuner needle.
+ *			Uploads go through framebuffer, see lcd_fb.h. Manager owns all CGRAM slots, 
+ *			so "%0".."%7" of LCDWriteString() should not be used with it
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+
+#ifndef lcd_glyph_h_
+#define lcd_glyph_h_
+
+#include "lcd_fb.h"
+
+#include <stdint.h>
+
+//HD44780 character ROM full block
+#define LCD_GLYPH_FULL_BLOCK 0xFF
+//Returned instead of glyph when all slots are shown on screen
+#define LCD_GLYPH_UNAVAILABLE ' '
+
+//Big digit size in characters
+#define LCD_GLYPH_BIG_DIGIT_WIDTH 3
+#define LCD_GLYPH_BIG_DIGIT_HEIGHT 2
+
+//Horizontal resolution of character cell for bar graph and needle
+#define LCD_GLYPH_CELL_STEPS 5
+
+/*
+ * @brief	Get character code of glyph, upload it if it is not resident. 
+ *			Slots used by framebuffer cells are never replaced, so screen content is not changed.
+ *			Put returned code to framebuffer before next request, otherwise slot is not pinned
+ * @param	glyph -	LCD_FB_GLYPH_HEIGHT rows in PROGMEM
+ * @return	character code 0..7, LCD_GLYPH_UNAVAILABLE if all 8 slots are on screen
+ */
+uint8_t lcdGlyphGet(const uint8_t* glyph);
+
+/*
+ * @brief	Forget resident glyphs, e.g. after LCDInit() which loads custom_char.h table
+ */
+void lcdGlyphReset();
+
+/*
+ * @brief	Draw digit 0..9 with LCD_GLYPH_BIG_DIGIT_WIDTH x LCD_GLYPH_BIG_DIGIT_HEIGHT characters. Uses 3 glyphs
+ * @param	x, y -	top left character
+ */
+void lcdGlyphDrawBigDigit(uint8_t x, uint8_t y, uint8_t digit);
+
+/*
+ * @brief	Draw number with big digits, right aligned, leading zeros are blank. Digits are separated by one column
+ * @param	digits -	field width in digits
+ */
+void lcdGlyphDrawBigNumber(uint8_t x, uint8_t y, uint16_t value, uint8_t digits);
+
+/*
+ * @brief	Draw horizontal bar graph. Uses up to 4 glyphs
+ * @param	width -	bar width in characters
+ * @param	value -	filled columns, 0..width * LCD_GLYPH_CELL_STEPS
+ */
+void lcdGlyphDrawBar(uint8_t x, uint8_t y, uint8_t width, uint8_t value);
+
+/*
+ * @brief	Draw tuner needle, single vertical line in field of spaces. Uses 1 glyph
+ * @param	width -		field width in characters
+ * @param	position -	needle column, 0..width * LCD_GLYPH_CELL_STEPS - 1
+ */
+void lcdGlyphDrawNeedle(uint8_t x, uint8_t y, uint8_t width, uint8_t position);
+
+#endif /* lcd_glyph_h_ */
@@ -49,6 +49,9 @@ me@avinashgupta.com
 #include <util/delay.h>
 
 #include "lcd_tb.h"
+#include "portio.h"
+#include "timer.h"
+#include "fmt.h"
 
 //Custom Charset support
 #include "custom_char.h"
@@ -65,13 +68,14 @@ me@avinashgupta.com
 
 #define LCD_DATA_PIN	PIN(LCD_DATA)
 
-#define SET_E() (LCD_E_PORT|=(1<<LCD_E_POS))
-#define SET_RS() (LCD_RS_PORT|=(1<<LCD_RS_POS))
-#define SET_RW() (LCD_RW_PORT|=(1<<LCD_RW_POS))
+//Control lines are resolved at compile time, each macro is a single sbi/cbi. See portio.h
+#define SET_E() IO_SET_BIT(LCD_E_PORT, LCD_E_POS)
+#define SET_RS() IO_SET_BIT(LCD_RS_PORT, LCD_RS_POS)
+#define SET_RW() IO_SET_BIT(LCD_RW_PORT, LCD_RW_POS)
 
-#define CLEAR_E() (LCD_E_PORT&=(~(1<<LCD_E_POS)))
-#define CLEAR_RS() (LCD_RS_PORT&=(~(1<<LCD_RS_POS)))
-#define CLEAR_RW() (LCD_RW_PORT&=(~(1<<LCD_RW_POS)))
+#define CLEAR_E() IO_CLEAR_BIT(LCD_E_PORT, LCD_E_POS)
+#define CLEAR_RS() IO_CLEAR_BIT(LCD_RS_PORT, LCD_RS_POS)
+#define CLEAR_RW() IO_CLEAR_BIT(LCD_RW_PORT, LCD_RW_POS)
 
 #ifdef LCD_TYPE_162
 	#define LCD_TYPE_204
@@ -82,21 +86,26 @@ me@avinashgupta.com
 #endif
 
 
-void LCDByte(uint8_t c,uint8_t isdata)
+static void LCDWriteNibble(uint8_t n)
 {
-//Sends a byte to the LCD in 4bit mode
-//cmd=0 for data
-//cmd=1 for command
+uint8_t temp;
 
+SET_E();
 
-//NOTE: THIS FUNCTION RETURS ONLY WHEN LCD HAS PROCESSED THE COMMAND
+temp=(LCD_DATA_PORT & (~(0X0F<<LCD_DATA_POS)))|((n<<LCD_DATA_POS));
+LCD_DATA_PORT=temp;
 
-uint8_t hn,ln;			//Nibbles
-uint8_t temp;
+_delay_us(1);			//tEH
+
+//Now data lines are stable pull E low for transmission
+
+CLEAR_E();
 
-hn=c>>4;
-ln=(c & 0x0F);
+_delay_us(1);			//tEL
+}
 
+static void LCDWriteByte(uint8_t c,uint8_t isdata)
+{
 if(isdata==0)
 	CLEAR_RS();
 else
@@ -104,35 +113,185 @@ else
 
 _delay_us(0.500);		//tAS
 
-SET_E();
+//Send high nibble, then the lower nibble
+LCDWriteNibble(c>>4);
+LCDWriteNibble(c & 0x0F);
+}
 
-//Send high nibble
+#ifdef LCD_WRITE_ONLY
 
-temp=(LCD_DATA_PORT & (~(0X0F<<LCD_DATA_POS)))|((hn<<LCD_DATA_POS));
-LCD_DATA_PORT=temp;
+/*
+Write-only mode. Busy flag is never read, each command is given its
+datasheet execution time measured by Timer2 timebase, see timer.h.
+Initialization is a state machine stepped by millisecond timer callback.
+*/
 
-_delay_us(1);			//tEH
+//Execution times with margin, us
+#define LCD_EXEC_TIME_US		50		//37us by datasheet
+#define LCD_EXEC_TIME_LONG_US	2000	//clear and home, 1.52ms by datasheet
+#define LCD_POWER_ON_DELAY_MS	40		//since reset
 
-//Now data lines are stable pull E low for transmission
+#define LCD_INIT_CGRAM_STEP	9
 
-CLEAR_E();
+static volatile bool initDone;
+static volatile uint32_t readyAt;		//display is busy until this time, us
+static uint8_t initStyle;
+static uint8_t initStep;
+static bool initRegistered;
 
-_delay_us(1);
+static bool LCDExecTimePassed()
+{
+	return (int32_t)(getMicros() - readyAt) >= 0;
+}
 
-//Send the lower nibble
-SET_E();
+static void LCDSetExecTime(uint16_t us)
+{
+	readyAt = getMicros() + us;
+}
 
-temp=(LCD_DATA_PORT & (~(0X0F<<LCD_DATA_POS)))|((ln<<LCD_DATA_POS));
+bool LCDIsReady()
+{
+	return initDone && LCDExecTimePassed();
+}
 
-LCD_DATA_PORT=temp;
+//One initialization step per millisecond, so boot is never stalled
+static void LCDInitCallback()
+{
+	uint8_t cgramIndex;
+	
+	if(initDone || !LCDExecTimePassed())
+		return;
+	
+	switch(initStep)
+	{
+		case 0:
+			if(getMillis() < LCD_POWER_ON_DELAY_MS)
+				return;
+			CLEAR_RS();
+			LCDWriteNibble(0b0011);		//8-bit mode reset sequence
+			LCDSetExecTime(4100);
+			break;
+		
+		case 1:
+		case 2:
+			LCDWriteNibble(0b0011);
+			LCDSetExecTime(100);
+			break;
+		
+		case 3:
+			LCDWriteNibble(0b0010);		//4-bit mode
+			LCDSetExecTime(100);
+			break;
+		
+		case 4:
+			LCDWriteByte(0b00101000,0);	//function set 4-bit,2 line 5x7 dot format
+			LCDSetExecTime(LCD_EXEC_TIME_US);
+			break;
+		
+		case 5:
+			LCDWriteByte(0b00001100|initStyle,0);	//Display On
+			LCDSetExecTime(LCD_EXEC_TIME_US);
+			break;
+		
+		case 6:
+			LCDWriteByte(0b00000001,0);	//clear
+			LCDSetExecTime(LCD_EXEC_TIME_LONG_US);
+			break;
+		
+		case 7:
+			LCDWriteByte(0b00000110,0);	//entry mode, increment
+			LCDSetExecTime(LCD_EXEC_TIME_US);
+			break;
+		
+		case 8:
+			LCDWriteByte(0b01000000,0);	//custom char
+			LCDSetExecTime(LCD_EXEC_TIME_US);
+			break;
+		
+		default:
+			cgramIndex = initStep - LCD_INIT_CGRAM_STEP;
+			if(cgramIndex < sizeof(__cgram))
+			{
+				LCDWriteByte(__cgram[cgramIndex],1);
+			}
+			else
+			{
+				LCDWriteByte(0b10000000,0);	//goto 0,0
+				initDone = true;
+			}
+			LCDSetExecTime(LCD_EXEC_TIME_US);
+			break;
+	}
+	++initStep;
+}
 
-_delay_us(1);			//tEH
+void LCDByte(uint8_t c,uint8_t isdata)
+{
+//Sends a byte to the LCD in 4bit mode when previous command is executed
+	
+LCDBusyLoop();
 
-//SEND
+LCDWriteByte(c,isdata);
 
-CLEAR_E();
+if(isdata==0 && c<0b00000100)
+	LCDSetExecTime(LCD_EXEC_TIME_LONG_US);	//clear and home
+else
+	LCDSetExecTime(LCD_EXEC_TIME_US);
+}
 
-_delay_us(1);			//tEL
+void LCDBusyLoop()
+{
+	//Wait till previous command is executed and initialization is done
+	while(!LCDIsReady());
+}
+
+void LCDInit(uint8_t style)
+{
+	/*****************************************************************
+	
+	Write-only mode initialization. Function returns at once, 
+	display is initialized in background from timer interrupt in about 
+	120ms since reset. LCD functions called earlier wait for it, see LCDIsReady()
+
+	*****************************************************************/
+	
+	//Set IO Ports
+	LCD_DATA_DDR|=(0x0F<<LCD_DATA_POS);
+	LCD_E_DDR|=(1<<LCD_E_POS);
+	LCD_RS_DDR|=(1<<LCD_RS_POS);
+	LCD_RW_DDR|=(1<<LCD_RW_POS);
+
+	LCD_DATA_PORT&=(~(0x0F<<LCD_DATA_POS));
+	CLEAR_E();
+	CLEAR_RW();		//RW is always low
+	CLEAR_RS();
+	
+	initStyle = style;
+	initStep = 0;
+	initDone = false;
+	LCDSetExecTime(0);
+	
+	if(!initRegistered)
+		initRegistered = timerRegisterMsCallback(LCDInitCallback);
+}
+
+#else
+
+bool LCDIsReady()
+{
+	return true;//LCDByte() waits for busy flag itself
+}
+
+void LCDByte(uint8_t c,uint8_t isdata)
+{
+//Sends a byte to the LCD in 4bit mode
+//cmd=0 for data
+//cmd=1 for command
+
+
+//NOTE: THIS FUNCTION RETURS ONLY WHEN LCD HAS PROCESSED THE COMMAND
+
+LCDWriteByte(c,isdata);
 
 LCDBusyLoop();
 }
@@ -248,6 +407,8 @@ void LCDInit(uint8_t style)
 	LCDGotoXY(0,0);
 
 }
+#endif
+
 void LCDWriteString(const char *msg)
 {
 	/*****************************************************************
@@ -313,28 +474,18 @@ void LCDWriteInt(int val,unsigned int field_length)
 	1)int val	: Value to print
 
 	2)unsigned int field_length :total length of field in which the value is printed
-	must be between 1-5 if it is -1 the field length is no of digits in the val
+	must be between 1-5, value is padded with leading zeros. If it is -1 the field 
+	length is no of digits in the val. Sign is printed before zeros
 
 	****************************************************************/
 
-	char str[5]={0,0,0,0,0};
-	int i=4,j=0;
-	while(val)
-	{
-	str[i]=val%10;
-	val=val/10;
-	i--;
-	}
-	if(field_length==-1)
-		while(str[j]==0) j++;
-	else
-		j=5-field_length;
+	char str[FMT_INT_SIZE];
+	
+	if(field_length==(unsigned int)-1)
+		field_length=0;
 
-	if(val<0) LCDData('-');
-	for(i=j;i<5;i++)
-	{
-	LCDData(48+str[i]);
-	}
+	fmtInt(str,val,field_length,'0');
+	LCDWriteString(str);
 }
 void LCDGotoXY(uint8_t x,uint8_t y)
 {
@@ -53,6 +53,7 @@ me@avinashgupta.com
 #include <avr/io.h>
 
 #include <util/delay.h>
+#include <stdbool.h>
 
 #include "myutils.h"
 
@@ -97,6 +98,19 @@ Uncomment Just one of them
 
 //************************************************
 
+/***********************************************
+
+Write-only mode. Uncomment to skip busy flag reading,
+commands are timed by Timer2 timebase instead. LCDInit()
+returns at once, initialization is done in background.
+Timer must be initialized first, see timer.h
+
+************************************************/
+
+//#define LCD_WRITE_ONLY
+
+//************************************************
+
 
 
 
@@ -125,6 +139,7 @@ void LCDByte(uint8_t,uint8_t);
 #define LCDData(d) (LCDByte(d,1))
 
 void LCDBusyLoop();
+bool LCDIsReady();	//display can accept next byte without waiting
 
 
 
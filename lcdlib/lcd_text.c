@@ -0,0 +1,134 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	lcd_text.c
+ * 
+ * @brief	Text layout over LCD framebuffer
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "lcd_text.h"
+#include "timer.h"
+#include "fmt.h"
+
+#include <string.h>
+
+static LcdTextField* fields[LCD_TEXT_FIELDS_MAX];
+static uint8_t fieldsNum;
+
+//Put length characters of str from offset to field, text which fits the field is aligned
+static void renderText(uint8_t x, uint8_t y, uint8_t width, const char* str, uint8_t length, uint8_t offset, uint8_t align)
+{
+	uint8_t pad = 0;
+	uint8_t i;
+	
+	if(length < width)
+	{
+		if(align == LCD_TEXT_RIGHT)
+			pad = width - length;
+		else if(align == LCD_TEXT_CENTER)
+			pad = (width - length) >> 1;
+	}
+	
+	lcdFbGotoXY(x, y);
+	for(i = 0; i < width; ++i)
+	{
+		if(i < pad || i - pad + offset >= length)
+			lcdFbPutChar(' ');
+		else
+			lcdFbPutChar(str[i - pad + offset]);
+	}
+}
+
+static uint8_t textLength(const char* str)
+{
+	size_t length = strlen(str);
+	return length > 0xFF ? 0xFF : (uint8_t)length;
+}
+
+void lcdTextWrite(uint8_t x, uint8_t y, uint8_t width, const char* str, LcdTextAlign align)
+{
+	renderText(x, y, width, str, textLength(str), 0, align);
+}
+
+void lcdTextWriteNumber(uint8_t x, uint8_t y, uint8_t width, int16_t value)
+{
+	char str[FMT_INT_SIZE];
+	uint8_t length = fmtInt(str, value, 0, ' ') - str;
+	
+	if(length > width)
+	{
+		memset(str, '#', width);
+		length = width;
+	}
+	
+	renderText(x, y, width, str, length, 0, LCD_TEXT_RIGHT);
+}
+
+bool lcdTextAddField(LcdTextField* field, uint8_t x, uint8_t y, uint8_t width, LcdTextAlign align)
+{
+	if(fieldsNum == LCD_TEXT_FIELDS_MAX)
+		return false;
+	
+	field->x_ = x;
+	field->y_ = y;
+	field->width_ = width;
+	field->align_ = align;
+	lcdTextSetText(field, "");
+	
+	fields[fieldsNum++] = field;
+	return true;
+}
+
+void lcdTextSetText(LcdTextField* field, const char* str)
+{
+	field->text_ = str;
+	field->length_ = textLength(str);
+	field->offset_ = 0;
+	field->hold_ = LCD_TEXT_SCROLL_HOLD_STEPS;
+	field->stepTime_ = (uint16_t)getMillis();
+	
+	renderText(field->x_, field->y_, field->width_, str, field->length_, 0, field->align_);
+}
+
+//Text is held at the beginning, scrolled by one character to the end, held and shown from the beginning again
+static void scrollField(LcdTextField* field)
+{
+	if(field->hold_)
+	{
+		--field->hold_;
+		return;
+	}
+	
+	if(field->offset_ + field->width_ < field->length_)
+	{
+		++field->offset_;
+		if(field->offset_ + field->width_ == field->length_)
+			field->hold_ = LCD_TEXT_SCROLL_HOLD_STEPS;
+	}
+	else
+	{
+		field->offset_ = 0;
+		field->hold_ = LCD_TEXT_SCROLL_HOLD_STEPS;
+	}
+	
+	renderText(field->x_, field->y_, field->width_, field->text_, field->length_, field->offset_, field->align_);
+}
+
+void lcdTextProcess()
+{
+	uint16_t now = (uint16_t)getMillis();
+	LcdTextField* field;
+	uint8_t i;
+	
+	for(i = 0; i < fieldsNum; ++i)
+	{
+		field = fields[i];
+		if(field->length_ <= field->width_ || (uint16_t)(now - field->stepTime_) < LCD_TEXT_SCROLL_STEP_MS)
+			continue;
+		
+		field->stepTime_ = now;
+		scrollField(field);
+	}
+}
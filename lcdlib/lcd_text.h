@@ -0,0 +1,80 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	lcd_text.h
+ * 
+ * @brief	Text layout over LCD framebuffer: aligned strings, right aligned numbers and 
+ *			scrolling fields for strings longer than field width. See lcd_fb.h
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+
+#ifndef lcd_text_h_
+#define lcd_text_h_
+
+#include "lcd_fb.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Maximum number of scrolling fields
+#define LCD_TEXT_FIELDS_MAX 4
+
+//Scroll step period, ms
+#ifndef LCD_TEXT_SCROLL_STEP_MS
+#	define LCD_TEXT_SCROLL_STEP_MS 350
+#endif
+
+//Number of steps text is held at the begin and at the end before scrolling
+#define LCD_TEXT_SCROLL_HOLD_STEPS 4
+
+typedef enum LcdTextAlign
+{
+	LCD_TEXT_LEFT = 0
+	,LCD_TEXT_CENTER
+	,LCD_TEXT_RIGHT
+}LcdTextAlign;
+
+//Scrolling field. Text is not copied, it must be valid while it is shown
+typedef struct LcdTextField
+{
+	const char* text_;
+	uint8_t x_;
+	uint8_t y_;
+	uint8_t width_;
+	uint8_t align_;		//LcdTextAlign, used if text fits the field
+	uint8_t length_;
+	uint8_t offset_;	//first visible character
+	uint8_t hold_;		//steps left before next scroll step
+	uint16_t stepTime_;	//getMillis() of last step, low 16 bits
+}LcdTextField;
+
+/*
+ * @brief	Write string to field, padded with spaces. Text longer than field is cut
+ */
+void lcdTextWrite(uint8_t x, uint8_t y, uint8_t width, const char* str, LcdTextAlign align);
+
+/*
+ * @brief	Write number right aligned, padded with spaces. '#' characters are shown if number does not fit
+ */
+void lcdTextWriteNumber(uint8_t x, uint8_t y, uint8_t width, int16_t value);
+
+/*
+ * @brief	Register scrolling field, it is scrolled by lcdTextProcess()
+ * @return	false if there are LCD_TEXT_FIELDS_MAX fields already
+ */
+bool lcdTextAddField(LcdTextField* field, uint8_t x, uint8_t y, uint8_t width, LcdTextAlign align);
+
+/*
+ * @brief	Set field text and show it from the beginning. Text longer than field width is scrolled
+ */
+void lcdTextSetText(LcdTextField* field, const char* str);
+
+/*
+ * @brief	Scroll fields by timer. Each step writes only field cells to framebuffer,
+ *			unchanged characters are not sent to display. Should be invoked in main loop
+ */
+void lcdTextProcess();
+
+#endif /* lcd_text_h_ */
@@ -14,17 +14,81 @@
 #include <stdint.h>
 
 #define ADC_VREF_TYPE 0x60
+//Voltage reference is VCC, result is right adjusted. Used for free running scan
+#define ADC_SCAN_VREF_TYPE 0x40
+
+//Oversampling for free running scan. 4^N samples are accumulated and decimated by N bits,
+//so scan result have 10 + N bits. Requires at least 1 LSB of noise on input, what is usual for pedals.
+//User can redefine this value, allowed range is 0..3
+#ifndef ADC_OVERSAMPLING_BITS
+#	define ADC_OVERSAMPLING_BITS 2
+#endif
+
+#if ADC_OVERSAMPLING_BITS > 3
+#	error "ADC_OVERSAMPLING_BITS is too big, accumulator will overflow"
+#endif
+
+#define ADC_OVERSAMPLING_SAMPLES (1 << (2*ADC_OVERSAMPLING_BITS))
+#define ADC_SCAN_RESULT_BITS (10 + ADC_OVERSAMPLING_BITS)
 
 /*
  * @brief	Default ADC initialization. Voltage reference is VCC, clock 62,5 KHz
  */
 void initAdc();
 
+//maximum number of channels in free running scan list
+#define ADC_SCAN_MAX_CHANNELS 8
+
+//Disabled scan channels are converted once per ADC_SCAN_PROBE_PERIOD rotations of scan list,
+//so state of input is still tracked, e.g. to detect plugged pedal
+#ifndef ADC_SCAN_PROBE_PERIOD
+#	define ADC_SCAN_PROBE_PERIOD 16
+#endif
+
+//If all channels are disabled, ADC is stopped after probe rotation and started again 
+//after this time by millisecond timer callback
+#ifndef ADC_SCAN_IDLE_PROBE_MS
+#	define ADC_SCAN_IDLE_PROBE_MS 50
+#endif
+
 /*
- * @brief	Read the 8 most significant bits of the AD conversion result
+ * @brief	Read the 8 most significant bits of the AD conversion result. 
+ *			Blocking call, should not be used while channel scan is running
  */
 uint8_t adcRead8MsbBit(uint8_t chanNum);
 
+/*
+ * @brief	Start free running conversions driven by ADC interrupt. Channels are converted 
+ *			in round-robin order. Two samples after each mux switch are discarded: the one running
+ *			on old channel and the first one on new channel, it lets input settle.
+ *			ADC_OVERSAMPLING_SAMPLES samples are taken from each channel before mux switch.
+ *			Global interrupts must be enabled to get results
+ * @param	channels -		ADC channels numbers. Array is copied, so caller may release it
+ * @param	channelsNum -	number of channels in list, up to ADC_SCAN_MAX_CHANNELS
+ */
+void adcStartScan(const uint8_t* channels, uint8_t channelsNum);
+
+/*
+ * @brief	Get last converted value of scan channel. Non-blocking
+ * @param	chanIndex -	channel index in list passed to adcStartScan(), not ADC channel number
+ * @return	oversampled value, ADC_SCAN_RESULT_BITS bits width
+ */
+uint16_t adcGetScanResult(uint8_t chanIndex);
+
+/*
+ * @brief	Get channels converted since previous call and clear this information
+ * @return	bit mask, bit N is set if channel with index N has new value
+ */
+uint8_t adcGetScanUpdates();
+
+/*
+ * @brief	Select channels converted in each rotation of scan list. All channels are enabled by adcStartScan().
+ *			Disabled channels are probed every ADC_SCAN_PROBE_PERIOD rotations, 
+ *			or every ADC_SCAN_IDLE_PROBE_MS if all channels are disabled
+ * @param	enabledMask - bit N is set if channel with index N is enabled
+ */
+void adcSetScanEnabled(uint8_t enabledMask);
+
 
 
 #endif /* adc_h_ */
\ No newline at end of file
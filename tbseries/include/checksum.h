@@ -0,0 +1,67 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	checksum.h
+ * 
+ * @brief	CRC and checksum kernels. All of them are incremental: pass init value
+ *			for the first block, then result of previous call for next blocks.
+ *			Check values for ASCII "123456789":
+ *			CRC-8/Maxim (Dallas 1-wire)		0xA1
+ *			CRC-16/CCITT-FALSE				0x29B1
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+
+#ifndef checksum_h_
+#define checksum_h_
+
+#include <stdint.h>
+
+//Uncomment to use two 16-byte tables for CRC-8 instead of 256-byte table.
+//About 2 times slower, saves 224 bytes of flash
+//#define CHECKSUM_CRC8_NIBBLE_TABLE
+
+#define CRC8_MAXIM_INIT 0x00
+#define CRC16_CCITT_INIT 0xFFFF
+#define XOR_CHECKSUM_INIT 0x00
+
+/*
+ * @brief	CRC-8/Maxim, polynomial x^8+x^5+x^4+1, reflected. Used by DS2411 ROM code
+ * @param	crc - CRC8_MAXIM_INIT or result of previous call
+ * @return	updated CRC
+ */
+uint8_t crc8MaximUpdate(uint8_t crc, const void* data, uint16_t size);
+
+/*
+ * @brief	CRC-8/Maxim of one block
+ */
+static inline uint8_t crc8Maxim(const void* data, uint16_t size)
+{
+	return crc8MaximUpdate(CRC8_MAXIM_INIT, data, size);
+}
+
+/*
+ * @brief	CRC-16/CCITT-FALSE, polynomial 0x1021, not reflected. Used for EEPROM blocks.
+ *			Calculated without table, few shifts per byte
+ * @param	crc - CRC16_CCITT_INIT or result of previous call
+ * @return	updated CRC
+ */
+uint16_t crc16CcittUpdate(uint16_t crc, const void* data, uint16_t size);
+
+/*
+ * @brief	CRC-16/CCITT-FALSE of one block
+ */
+static inline uint16_t crc16Ccitt(const void* data, uint16_t size)
+{
+	return crc16CcittUpdate(CRC16_CCITT_INIT, data, size);
+}
+
+/*
+ * @brief	XOR of all bytes, as used by Fractal Audio SysEx. Mask result with 0x7F before send
+ * @param	sum - XOR_CHECKSUM_INIT, precalculated XOR of constant header or result of previous call
+ * @return	updated checksum
+ */
+uint8_t xorChecksumUpdate(uint8_t sum, const void* data, uint16_t size);
+
+#endif /* checksum_h_ */
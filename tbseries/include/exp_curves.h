@@ -0,0 +1,29 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	exp_curves.h
+ * 
+ * @brief	Expression pedal response curves lookup tables
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#ifndef exp_curves_h_
+#define exp_curves_h_
+
+#include <stdint.h>
+
+/*
+ * Curve table entry N is the curve value at pedal position N/256, scaled to 0..256 range
+ * and saturated to 255. Value at position 256/256 is 256 and not stored in table.
+ * Intermediate positions are linear interpolated, see expression.c
+ */
+#define EXP_CURVE_TABLE_SIZE 256
+#define EXP_CURVE_TABLE_END 256
+
+//Tables are placed in PROGMEM
+extern const uint8_t expCurveLog[EXP_CURVE_TABLE_SIZE];
+extern const uint8_t expCurveExp[EXP_CURVE_TABLE_SIZE];
+extern const uint8_t expCurveS[EXP_CURVE_TABLE_SIZE];
+
+#endif /* exp_curves_h_ */
@@ -0,0 +1,74 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	exp_filter.h
+ * 
+ * @brief	Expression pedal input filter. Integer only, stages are applied in order:
+ *			median of N samples, exponential moving average, deadband.
+ *			Deadband is adaptive: measured jitter of input widens it, see noiseGain_
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#ifndef exp_filter_h_
+#define exp_filter_h_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EXP_FILTER_MEDIAN_MAX 5
+#define EXP_FILTER_EMA_SHIFT_MAX 8
+//Noise estimate is an average of input reversal steps over about 2^EXP_FILTER_NOISE_SHIFT samples
+#define EXP_FILTER_NOISE_SHIFT 4
+
+//Filter settings. Input and output values are 14-bit
+typedef struct ExpFilterConfig
+{
+	uint8_t medianSize_;	//1 - disabled, 3 or 5 samples. Removes single sample spikes
+	uint8_t emaShift_;		//0 - disabled, smoothing factor is 1/(2^emaShift_). Each step adds delay
+	uint16_t deadband_;		//Minimal band, 0 - disabled. Output changes direction only if input moves more than band
+	uint8_t noiseGain_;		//0 - fixed band. Band is deadband_ + noiseGain_ * measured noise, so it grows 
+							//with jitter of noisy cable and shrinks back when input is clean. 
+							//Steady movement is not counted as noise and keeps band narrow
+}ExpFilterConfig;
+
+//Default settings, minimal band is fixed hysteresis of previous versions: 1 LSB of 8-bit value.
+//Noise gain 2 keeps output still while input jitters around one point
+#define EXP_FILTER_DEFAULT_MEDIAN 1
+#define EXP_FILTER_DEFAULT_EMA_SHIFT 0
+#define EXP_FILTER_DEFAULT_DEADBAND (1 << (14 - 8))
+#define EXP_FILTER_DEFAULT_NOISE_GAIN 2
+
+typedef struct ExpFilterState
+{
+	uint16_t history_[EXP_FILTER_MEDIAN_MAX];
+	uint8_t historyPos_;
+	uint32_t emaSum_;		//average multiplied by 2^emaShift_
+	uint16_t output_;
+	bool rising_;			//direction of last output change
+	uint16_t lastInput_;	//deadband input of previous sample
+	bool inputRising_;		//direction of last input change
+	uint32_t noiseSum_;		//average reversal step multiplied by 2^EXP_FILTER_NOISE_SHIFT
+}ExpFilterState;
+
+/*
+ * @brief	Reset filter state to constant input value
+ */
+void expFilterReset(const ExpFilterConfig* config, ExpFilterState* state, uint16_t value);
+
+/*
+ * @brief	Put new sample to filter
+ * @return	filtered value
+ */
+uint16_t expFilterProcess(const ExpFilterConfig* config, ExpFilterState* state, uint16_t input);
+
+/*
+ * @brief	Measurement mode. Run filter over recorded trace of samples and count output changes,
+ *			i.e. number of messages which would be sent with this settings
+ * @param	trace - 14-bit samples, see expGetPedalRawValue()
+ * @param	outputBits - resolution of output: 7 for CC, 14 for 14-bit CC or NRPN
+ * @return	number of output value changes. First sample is not counted
+ */
+uint16_t expFilterMeasure(const ExpFilterConfig* config, const uint16_t* trace, uint16_t len, uint8_t outputBits);
+
+#endif /* exp_filter_h_ */
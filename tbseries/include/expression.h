@@ -12,7 +12,9 @@
 #define expression_h_
 
 #include "adc.h"
+#include "exp_filter.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef enum PedalNumber
 {
@@ -21,6 +23,109 @@ typedef enum PedalNumber
 	,EXP_PEDAL_ONBOARD	
 }PedalNumber;
 
+//Midi messages, which are sent automatically on pedal position change
+typedef enum ExpOutputMode
+{
+	EXP_OUTPUT_NONE = 0		//no midi output, position is passed to callback only
+	,EXP_OUTPUT_CC			//7-bit control change
+	,EXP_OUTPUT_CC_14BIT	//14-bit control change, MSB to ctrlNum and LSB to ctrlNum + 32
+	,EXP_OUTPUT_NRPN		//14-bit NRPN, value is sent via data entry CC 6 and CC 38
+}ExpOutputMode;
+
+//Pedal response curves
+typedef enum ExpCurve
+{
+	EXP_CURVE_LINEAR = 0
+	,EXP_CURVE_LOG			//fast rise at heel position
+	,EXP_CURVE_EXP			//slow rise at heel position, audio taper
+	,EXP_CURVE_S			//fine control near both ends of pedal travel
+	,EXP_CURVE_CUSTOM		//user table in EEPROM, see expSetCustomCurve()
+}ExpCurve;
+
+//Targets of pedal mapping
+typedef enum ExpTargetType
+{
+	EXP_TARGET_NONE = 0		//unused table entry
+	,EXP_TARGET_CC			//7-bit control change, param is CC number
+	,EXP_TARGET_CC_14BIT	//14-bit control change, param is CC number 0..31
+	,EXP_TARGET_NRPN		//14-bit NRPN, param is NRPN number
+	,EXP_TARGET_KPA			//Kemper parameter, param is KpaParamAddress. Sender must be registered, see kpa.h
+	,EXP_TARGET_AXEFX		//AxeFx parameter, see AXEFX_MAPPING_PARAM. Sender must be registered, see axefx.h
+}ExpTargetType;
+
+/*
+ * Mapping table entry, 8 bytes. One pedal can drive several targets, e.g. wah position and volume.
+ * Output value is min_ + (max_ - min_) * curve(position), so min_ greater than max_ also gives inverted response
+ * Values range: CC - 0..127, 14-bit CC, NRPN and KPA - 0..16383, AxeFx - 0..65534
+ */
+typedef struct ExpMapping
+{
+	uint8_t target_;	//EXP_MAPPING_TARGET(pedal, type)
+	uint8_t options_;	//EXP_MAPPING_OPTIONS(chanNum, curve, flags)
+	uint16_t param_;	//controller number or parameter address, depends on type
+	uint16_t min_;		//value at heel position
+	uint16_t max_;		//value at toe position
+}ExpMapping;
+
+#define EXP_MAPPING_MAX 8
+
+//Invert pedal position before curve is applied
+#define EXP_MAPPING_INVERT 0x80
+
+#define EXP_MAPPING_TARGET(pedal, type) ((uint8_t)(((pedal) << 4) | (type)))
+#define EXP_MAPPING_OPTIONS(chanNum, curve, flags) ((uint8_t)(((curve) << 4) | ((chanNum) & 0x0F) | (flags)))
+
+#define EXP_MAPPING_GET_PEDAL(target) ((target) >> 4)
+#define EXP_MAPPING_GET_TYPE(target) ((target) & 0x0F)
+#define EXP_MAPPING_GET_CHANNEL(options) ((options) & 0x0F)
+#define EXP_MAPPING_GET_CURVE(options) (((options) >> 4) & 0x07)
+
+#define EXP_POSITION_14BIT_BITS 14
+
+//Default minimum interval between midi messages of one pedal, ms. 
+//Fast pedal sweep is sent as at most 100 messages per second, intermediate values are dropped
+#ifndef EXP_OUTPUT_DEFAULT_INTERVAL
+#	define EXP_OUTPUT_DEFAULT_INTERVAL 10
+#endif
+
+//Pedal output is postponed while midi transmitter queue holds more bytes than this value
+#ifndef EXP_OUTPUT_TX_QUEUE_LIMIT
+#	define EXP_OUTPUT_TX_QUEUE_LIMIT 12
+#endif
+
+//Minimum pedal travel accepted by calibration, in 16-bit ADC units (1/16 of full range)
+#define EXP_CALIBRATION_MIN_TRAVEL 0x1000
+//Presence detection. Unplugged input is pulled up to VCC, so its 14-bit value is near to the rail.
+//State is changed after EXP_PRESENCE_WINDOW consecutive samples on the other side of threshold
+#ifndef EXP_PRESENCE_RAIL_THRESHOLD
+#	define EXP_PRESENCE_RAIL_THRESHOLD 16320
+#endif
+#ifndef EXP_PRESENCE_WINDOW
+#	define EXP_PRESENCE_WINDOW 8
+#endif
+//Plugged pedal which came to rail from values above this threshold is at toe position rather than unplugged, 
+//so it is declared unplugged only after it stays on rail for EXP_PRESENCE_TOE_WINDOW_MS (up to 60000).
+//Window is measured by millisecond timer, so it does not depend on number of scanned channels.
+//Pedal parked at toe for longer time is reported unplugged and then plugged again when it is moved,
+//and pedal unplugged while at toe is reported unplugged only after the window
+#ifndef EXP_PRESENCE_TOE_THRESHOLD
+#	define EXP_PRESENCE_TOE_THRESHOLD (EXP_PRESENCE_RAIL_THRESHOLD - 2048)
+#endif
+#ifndef EXP_PRESENCE_TOE_WINDOW_MS
+#	define EXP_PRESENCE_TOE_WINDOW_MS 10000
+#endif
+#if EXP_PRESENCE_TOE_WINDOW_MS > 60000
+#	error "EXP_PRESENCE_TOE_WINDOW_MS is too big, 16-bit millisecond timestamp will overflow"
+#endif
+
+//Pickup mode releases output when pedal is closer to target value than this, 14-bit units. 1 step of 7-bit value by default
+#ifndef EXP_PICKUP_WINDOW
+#	define EXP_PICKUP_WINDOW (1 << 7)
+#endif
+
+//Learned travel is shortened by 1/32 on both ends, so pedal reliably reaches min and max values
+#define EXP_CALIBRATION_MARGIN_SHIFT 5
+
 /*
  * @brief	Initialization of expression pedals driver 
  */
@@ -28,9 +133,125 @@ void initExpression();
 
 /*
  * @brief	Get expression pedal position. Max position is 127, min - 0
+ *			Pedals are sampled in background by ADC interrupt and filtered by expProcess(), 
+ *			so this function only reads last filtered value
  */
 uint8_t expGetPedalPosition(PedalNumber pedalNumber);
 
+/*
+ * @brief	Get expression pedal position in high resolution. Max position is 16383, min - 0
+ *			Effective resolution is ADC_SCAN_RESULT_BITS, see adc.h
+ */
+uint16_t expGetPedalPosition14Bit(PedalNumber pedalNumber);
+
+/*
+ * @brief	Get last 14-bit ADC sample without filtering, calibration and curve.
+ *			Use it to record trace for expFilterMeasure(), see exp_filter.h
+ */
+uint16_t expGetPedalRawValue(PedalNumber pedalNumber);
+
+/*
+ * @brief	Set input filter of pedal. Default settings are EXP_FILTER_DEFAULT_*, see exp_filter.h
+ *			Filter is restarted from next sample
+ */
+void expSetPedalFilter(PedalNumber pedalNumber, const ExpFilterConfig* config);
+
+/*
+ * @brief	Set midi message which will sent by expProcess() on pedal position change.
+ *			For 14-bit modes LSB only is sent when MSB is not changed, this keeps midi traffic low  
+ * @param	pedalNumber -	pedal
+ * @param	mode -			output mode. EXP_OUTPUT_NONE to disable output
+ * @param	ctrlNum -		controller number for CC modes (0..31 for EXP_OUTPUT_CC_14BIT), 
+ *							14-bit parameter number for EXP_OUTPUT_NRPN
+ * @param	chanNum -		midi channel
+ */
+void expSetPedalOutput(PedalNumber pedalNumber, ExpOutputMode mode, uint16_t ctrlNum, uint8_t chanNum);
+
+/*
+ * @brief	Limit midi output rate of pedal. Position which arrives before interval is elapsed replaces 
+ *			previous unsent one, so only latest position is sent. Final pedal position is always sent.
+ *			Output is also postponed while midi link is busy, see EXP_OUTPUT_TX_QUEUE_LIMIT
+ * @param	minIntervalMs - minimum interval between messages, 1000 / interval is max messages per second.
+ *			0 - no limit. Default is EXP_OUTPUT_DEFAULT_INTERVAL
+ */
+void expSetPedalRateLimit(PedalNumber pedalNumber, uint16_t minIntervalMs);
+
+/*
+ * @brief	Set entry of mapping table. Mapped targets are sent with pedal midi output and use the same rate limit. 
+ *			Use expSaveMappings() to store table in EEPROM, it is loaded by initExpression()
+ * @param	index -		table entry, 0..EXP_MAPPING_MAX-1
+ * @param	mapping -	target description. Use EXP_TARGET_NONE type to clear entry
+ */
+void expSetMapping(uint8_t index, const ExpMapping* mapping);
+
+/*
+ * @brief	Store mapping table in EEPROM
+ */
+void expSaveMappings();
+
+/*
+ * @brief	Register function which sends vendor specific parameter for EXP_TARGET_KPA and EXP_TARGET_AXEFX targets.
+ *			E.g. kpaSendSingleParameterChange or axefxSendMappedParameter. Library core does not depend on vendors code,
+ *			so targets are ignored until sender is registered
+ */
+void expRegisterMappingSender(ExpTargetType type, void (*sender)(uint16_t param, uint16_t value));
+
+/*
+ * @brief	Enable or disable pickup (soft takeover) mode. In this mode output of pedal and its mapped targets
+ *			is suppressed after target value is changed outside, e.g. by preset change, 
+ *			until pedal crosses new target value. So there is no jump of parameter when pedal moves first time
+ */
+void expSetPickupMode(PedalNumber pedalNumber, bool enable);
+
+/*
+ * @brief	Set current value of target, e.g. parsed from vendor SysEx after preset change. 
+ *			Output is suppressed until pedal crosses this value. Ignored if pickup mode is disabled
+ * @param	value - target value converted to 14-bit pedal position scale
+ */
+void expPickupSetTargetValue(PedalNumber pedalNumber, uint16_t value);
+
+/*
+ * @brief	Learn target value from incoming control change. Pedals with EXP_OUTPUT_CC and EXP_OUTPUT_CC_14BIT output
+ *			on the same channel and controller are affected. 
+ *			Signature matches midi callback, so it can be passed to midiRegisterControlChangeCallback() directly
+ */
+void expPickupProcessControlChange(uint8_t channel, uint8_t ccNum, uint8_t ccVal);
+
+/*
+ * @brief	Check if pedal output is suppressed by pickup mode, e.g. to show it on display
+ */
+bool expIsPickupWaiting(PedalNumber pedalNumber);
+
+/*
+ * @brief	Start calibration. Move the pedal from heel to toe position several times, 
+ *			then call expCalibrationStop(). expProcess() must be invoked during calibration
+ */
+void expCalibrationStart(PedalNumber pedalNumber);
+
+/*
+ * @brief	Stop calibration and apply learned pedal travel. Use expSaveProfiles() to store it in EEPROM
+ * @return	true if calibration is applied, false if pedal travel was too short. Previous calibration is kept in this case
+ */
+bool expCalibrationStop(PedalNumber pedalNumber);
+
+/*
+ * @brief	Set response curve of pedal. Use expSaveProfiles() to store it in EEPROM
+ */
+void expSetPedalCurve(PedalNumber pedalNumber, ExpCurve curve);
+
+/*
+ * @brief	Store custom curve in EEPROM. Curve is used by all pedals with EXP_CURVE_CUSTOM curve.
+ * @param	table - EXP_CURVE_TABLE_SIZE values, value N is output at pedal position N/256 in 0..255 range.
+ *			See exp_curves.h
+ */
+void expSetCustomCurve(const uint8_t* table);
+
+/*
+ * @brief	Store calibration and curves of all pedals in EEPROM. Profiles are loaded by initExpression().
+ *			Only changed bytes are written, but it still takes some milliseconds
+ */
+void expSaveProfiles();
+
 /*
  * @brief	Register callback will invoked if any pedal change position
  */
@@ -41,9 +262,32 @@ void expRegisterPedalChangePositionCallback(void (*callback)(PedalNumber pedalNu
  */
 void expRegisterPedalChangePositionCallback(void (*callback)(PedalNumber pedalNumber, uint8_t position));
 
+/*
+ * @brief	Register callback will invoked if pedal is plugged or unplugged
+ */
+void expRegisterPedalPresenceCallback(void (*callback)(PedalNumber pedalNumber, bool connected));
+
+/*
+ * @brief	Register position indicator callback, e.g. ledPedalBarAttach() from pedal_led.h.
+ *			It is invoked together with position callback, so both of them can be used at the same time
+ */
+void expRegisterPedalDisplayCallback(void (*callback)(PedalNumber pedalNumber, uint8_t position));
+
+/*
+ * @brief	Check if pedal is plugged. Plugged pedals are detected in a few milliseconds after initExpression().
+ *			Unplugged pedals are excluded from ADC scan and from expProcess(), only rare probe samples are taken
+ */
+bool expIsPedalConnected(PedalNumber pedalNumber);
+
+/*
+ * @brief	Enable or disable presence detection. Enabled by default, except onboard pedal of TB-6P and TB-11P. 
+ *			Disable it for pedals which reach VCC rail at toe position, such pedal is always treated as connected
+ */
+void expSetPresenceDetection(PedalNumber pedalNumber, bool enable);
 
 /*
- * @brief	REad all pedals positions, and invoke registered callback if any pedals was turn. Should be invoked in main loop
+ * @brief	Check new pedals samples, send midi output and invoke registered callback if any pedals was turn.
+ *			Should be invoked in main loop
  */
 void expProcess();
 
@@ -0,0 +1,60 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	fmt.h
+ * 
+ * @brief	Small numbers formatting for LCD and log output without printf and division.
+ *			Decimal digits are produced by subtraction of powers of ten from PROGMEM table.
+ *			All functions write null-terminated string to caller buffer and return pointer 
+ *			to terminating null, so calls can be chained
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+
+#ifndef fmt_h_
+#define fmt_h_
+
+#include <stdint.h>
+
+//Buffer sizes with terminating null
+#define FMT_UINT_SIZE 6		//"65535"
+#define FMT_INT_SIZE 7		//"-32768"
+#define FMT_NOTE_SIZE 5		//"C#-1"
+
+/*
+ * @brief	Unsigned decimal
+ * @param	width -	minimal width, number is right aligned and padded with pad character
+ * @param	pad -	' ' or '0'
+ */
+char* fmtUint(char* buf, uint16_t value, uint8_t width, char pad);
+
+/*
+ * @brief	Signed decimal. Sign is placed before zeros padding
+ */
+char* fmtInt(char* buf, int16_t value, uint8_t width, char pad);
+
+/*
+ * @brief	Hexadecimal, upper case, 2 or 4 digits
+ */
+char* fmtHex8(char* buf, uint8_t value);
+char* fmtHex16(char* buf, uint16_t value);
+
+/*
+ * @brief	Signed fixed-point decimal, e.g. value -125 with 1 fraction digit is "-12.5"
+ * @param	fracDigits -	digits after point, 1..4
+ * @param	width -			minimal width, padded with spaces
+ */
+char* fmtFixed(char* buf, int16_t value, uint8_t fracDigits, uint8_t width);
+
+/*
+ * @brief	Gain in tenths of dB with explicit sign and suffix, e.g. "+3.5dB", "-12.0dB", "0.0dB"
+ */
+char* fmtDb(char* buf, int16_t tenthsDb);
+
+/*
+ * @brief	Note name of midi note number. Middle C 60 is "C4", 0 is "C-1"
+ */
+char* fmtNoteName(char* buf, uint8_t note);
+
+#endif /* fmt_h_ */
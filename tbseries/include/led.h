@@ -18,6 +18,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+//Auto flush period, ms. Default is 50 frames per second
+#ifndef LED_AUTO_FLUSH_PERIOD_MS
+#	define LED_AUTO_FLUSH_PERIOD_MS 20
+#endif
 
 typedef enum LedColor
 {
@@ -51,9 +55,51 @@ void ledSetColor(uint8_t ledNum, LedColor color, bool send);
 void ledSetColorAll(LedColor color, bool send);
 
 /*
- * @brief	Send data from internal buffer to shift register
+ * @brief	Send data from internal buffer to shift register. Nothing is sent if data is not changed since last sending.
+ *			Does nothing in auto flush mode, buffer is sent by timer. While any LED is animated, buffer is 
+ *			committed to animation engine instead, after ledEndUpdate() if update is in progress
  */
 void ledSend();
 
+/*
+ * @brief	Enable or disable auto flush. In this mode buffer is sent from timer interrupt every 
+ *			LED_AUTO_FLUSH_PERIOD_MS if it was changed, so many ledSetColor() calls are batched to one transfer
+ */
+void ledSetAutoFlush(bool enable);
+
+/*
+ * @brief	Hold auto flush and animation commit while several LEDs are changed, so half-updated state is never shown.
+ *			Calls may be nested, each call must be paired with ledEndUpdate()
+ */
+void ledBeginUpdate();
+
+/*
+ * @brief	Release auto flush held by ledBeginUpdate()
+ */
+void ledEndUpdate();
+
+/*
+ * @brief	Blink LED from timer interrupt, see led_anim.h. Overrides ledSetColor() for this LED
+ *			until ledStopAnimation(). Main loop load does not affect blink timing
+ * @param	periodMs -	blink period, up to 2550 ms
+ */
+void ledSetBlink(uint8_t ledNum, LedColor color, uint16_t periodMs);
+
+/*
+ * @brief	Smoothly fade LED in and out, see ledSetBlink()
+ */
+void ledSetPulse(uint8_t ledNum, LedColor color, uint16_t periodMs);
+
+/*
+ * @brief	Show LED with reduced brightness
+ * @param	level -		brightness, 0..LED_ANIM_MAX_LEVEL
+ */
+void ledSetBrightness(uint8_t ledNum, LedColor color, uint8_t level);
+
+/*
+ * @brief	Return LED to ledSetColor() control
+ */
+void ledStopAnimation(uint8_t ledNum);
+
 
 #endif /* led_h_ */
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	led_anim.h
+ * 
+ * @brief	LED animation engine over shift registers chains: blink, pulse and brightness levels.
+ *			Frames are composed and sent from Timer2 millisecond interrupt, so animation does not depend 
+ *			on main loop load. Brightness is made by binary code modulation with frame interleaving:
+ *			bit-plane N of brightness level is shown for 2^N frames
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#ifndef led_anim_h_
+#define led_anim_h_
+
+#include "lldled.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Brightness resolution. 3 bits gives 8 levels and 7ms modulation cycle (143 Hz)
+#define LED_ANIM_BRIGHTNESS_BITS 3
+#define LED_ANIM_MAX_LEVEL ((1 << LED_ANIM_BRIGHTNESS_BITS) - 1)
+
+//Blink and pulse phase step, ms. Periods are rounded to this value
+#define LED_ANIM_TICK_MS 10
+
+//Maximum number of animated chains
+#define LED_ANIM_CHAINS_MAX 2
+
+typedef enum LedAnimMode
+{
+	LED_ANIM_NONE = 0	//LED is controlled by chain buffer, see lldLedSetVal()
+	,LED_ANIM_STEADY	//constant brightness
+	,LED_ANIM_BLINK		//half of period is on, half is off
+	,LED_ANIM_PULSE		//brightness rises and falls linear
+}LedAnimMode;
+
+//Per LED state, 7 bytes
+typedef struct LedAnimState
+{
+	uint8_t mode_;		//LedAnimMode
+	uint8_t level_;		//max brightness, 0..LED_ANIM_MAX_LEVEL
+	uint8_t period_;	//LED_ANIM_TICK_MS units
+	uint8_t phase_;
+	uint8_t current_;	//brightness in bit-planes
+	uint16_t step_;		//pulse brightness increment per tick, 8.8 fixed point
+}LedAnimState;
+
+//Animated chain. Buffers are allocated by chain owner
+typedef struct LedAnimChain
+{
+	RegsChainDescriptor* chain_;
+	LedAnimState* leds_;	//chain_->ledsNum_ entries
+	uint8_t* planes_;		//LED_ANIM_PLANES_SIZE(regsNum_) bytes
+	uint8_t* mask_;			//regsNum_ bytes, bit is set for animated LED
+	uint8_t* frame_;		//regsNum_ bytes
+	uint8_t* committed_;	//regsNum_ bytes, snapshot of chain buffer shown for not animated LEDs, see ledAnimCommit()
+	uint8_t plane_;
+	uint8_t planeTicks_;
+}LedAnimChain;
+
+#define LED_ANIM_PLANES_SIZE(regsNum) (LED_ANIM_BRIGHTNESS_BITS * (regsNum))
+
+/*
+ * @brief	Start animation of chain. All buffers must be filled. After this call chain is sent every millisecond 
+ *			by timer interrupt, not animated LEDs are taken from committed snapshot, see ledAnimCommit().
+ *			lldLedSend() does nothing for attached chain. Chain is detached by ledAnimSet() when no LED is animated
+ * @return	false if there are LED_ANIM_CHAINS_MAX animated chains already or no timer callback slot
+ */
+bool ledAnimAttach(LedAnimChain* anim);
+
+/*
+ * @brief	Take snapshot of chain buffer for not animated LEDs. Call it instead of lldLedSend() for attached chain,
+ *			so changes of chain buffer are not shown until they are complete
+ */
+void ledAnimCommit(LedAnimChain* anim);
+
+/*
+ * @brief	Set animation of single physical LED
+ * @param	num -		number of physical LED in chain
+ * @param	mode -		animation mode. LED_ANIM_NONE returns LED to chain buffer control. If it was the last 
+ *						animated LED, chain is detached and committed snapshot is sent
+ * @param	level -		brightness, 0..LED_ANIM_MAX_LEVEL
+ * @param	periodMs -	blink or pulse period, up to 254 * LED_ANIM_TICK_MS. Rounded down to even number of ticks
+ */
+void ledAnimSet(LedAnimChain* anim, uint8_t num, LedAnimMode mode, uint8_t level, uint16_t periodMs);
+
+#endif /* led_anim_h_ */
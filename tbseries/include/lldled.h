@@ -15,10 +15,32 @@
 #include "portio.h"
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #define LED_ON  1//Active led value
 #define LED_OFF !LED_ON//
 
+//Buffer keeps inverted led values, this mask restores them on sending
+#define LLDLED_SEND_MASK ((LED_ON) ? 0xFF : 0x00)
+
+//Shift register number and bit mask of chain pin, for compile-time LED tables
+#define LLDLED_REG(pin) ((pin) >> 3)
+#define LLDLED_MASK(pin) (1 << ((pin) & 0x07))
+
+//Buffer value of pins in mask, pins which are also in onMask are on
+#define LLDLED_BUFFER_BITS(mask, onMask) ((~(onMask) & (mask)) ^ (~LLDLED_SEND_MASK & (mask)))
+
+//Set pins in mask of single buffer byte, pins which are also in onMask are on. Other pins are not changed
+#define LLDLED_WRITE_BITS(buffer, reg, mask, onMask) \
+	((buffer)[reg] = ((buffer)[reg] & ~(mask)) | LLDLED_BUFFER_BITS(mask, onMask))
+
+//Shift registers chain transport
+typedef enum LldLedTransport
+{
+	LLDLED_BITBANG = 0	//any pins, software clocking
+	,LLDLED_SPI			//CLK on SCK (PB1) and DATA on MOSI (PB2), hardware SPI master
+}LldLedTransport;
+
 /*
  * Interface descriptor.
  * Device with pedals have several shift registers chains with different chain length
@@ -32,13 +54,70 @@ typedef struct RegsChainDescriptor
     const ioPort* oe_;		
     uint8_t* buffer_;
     uint8_t* ledNumTable_;
+	LldLedTransport transport_;
+	void (*send_)(const uint8_t* buffer, uint8_t regsNum);//optional LLDLED_BITBANG sender, see LLDLED_DEFINE_BITBANG_SEND
+	uint8_t* sentBuffer_;	//optional copy of last transmitted data, regsNum_ bytes. Unchanged data is not sent again
+	bool sentValid_;		//sentBuffer_ holds transmitted data
+	bool animated_;			//chain is refreshed by animation engine, see led_anim.h
 }RegsChainDescriptor;
 
 /*
- * @brief	Send data to shift register 
+ * Define bit-bang sender of chain with compile-time resolved pins, see portio.h. 
+ * Assign it to send_ field of chain descriptor. 
+ * Cycles per bit at PORTA..PORTE pins: about 100 with portio.h functions calls, 
+ * about 20 with generic sender which uses port pointers from descriptor, about 11 with this sender
+ * @param	funcName -	name of generated function
+ * @param	clkName -	CLK pin name prefix, e.g. LED_CLK for LED_CLK_PORT and LED_CLK_PIN
+ * @param	dataName -	DATA pin name prefix
+ */
+#define LLDLED_DEFINE_BITBANG_SEND(funcName, clkName, dataName)		\
+static void funcName(const uint8_t* buffer, uint8_t regsNum)		\
+{																	\
+	uint8_t j;														\
+	uint8_t data;													\
+	buffer += regsNum;												\
+	while(regsNum--)												\
+	{																\
+		data = *(--buffer) ^ LLDLED_SEND_MASK;						\
+		for (j = 0; j < 8; j++)										\
+		{															\
+			IO_CLEAR(clkName);/*clock falling edge*/				\
+			IO_SET_TO_VAL(dataName, data & 0x80);					\
+			IO_SET(clkName);/*clock rising edge*/					\
+			data <<= 1;												\
+		}															\
+	}																\
+}
+
+/*
+ * @brief	Init SPI master for LLDLED_SPI transport: mode 0, MSB first, clock F_CPU/2.
+ *			SS pin (PB0) must be an output or held high, otherwise SPI drops master mode
+ */
+void lldLedInitSpi();
+
+/*
+ * @brief	Check if buffer is changed since last transmission. Always true if chain have no sentBuffer_
+ */
+bool lldLedIsDirty(const RegsChainDescriptor* interface);
+
+/*
+ * @brief	Send data to shift register if it is changed, see lldLedIsDirty(). Blocking call.
+ *			Animated chain is not sent, buffer is picked up by animation engine on next frame.
+ *			Bit-bang transport takes about 2.5us per bit at 8 MHz, SPI transport about 2.5us per register
  */
 void lldLedSend(RegsChainDescriptor* interface);
 
+/*
+ * @brief	Send data from external buffer to shift register, e.g. composed animation frame.
+ *			Nothing is sent if data is equal to last transmitted
+ */
+void lldLedSendData(RegsChainDescriptor* interface, const uint8_t* data);
+
+/*
+ * @brief	Set single LED in external buffer with the same layout as chain buffer
+ */
+void lldLedSetValInBuffer(RegsChainDescriptor* interface, uint8_t* buffer, uint8_t num, uint8_t val);
+
 /*
  * @brief	Set single LED. Data is not send to shift register
  * @param	num -	number if physical led
@@ -36,6 +36,33 @@ void midiSendProgramChange(uint8_t progNum, uint8_t chanNum);
  */
 void midiSendControlChange(uint8_t ctrlNum, uint8_t val, uint8_t chanNum);
 
+/*
+ * @brief	Send 14-bit control change as MSB/LSB pair. LSB is sent to controller ctrlNum + 32
+ * @param	ctrlNum - MSB controller number (0..31)
+ * @param	val - 14-bit controller value
+ * @param	chanNum - midi channel
+ * @param	lsbOnly - send only LSB, it saves bandwidth if MSB is the same as previously sent.
+ *			Receiver resets LSB after MSB, so MSB is always sent before LSB
+ */
+void midiSendControlChange14Bit(uint8_t ctrlNum, uint16_t val, uint8_t chanNum, bool lsbOnly);
+
+/*
+ * @brief	Send NRPN value. Parameter number (CC 99 and CC 98) is sent only if it differs from 
+ *			previously selected by this function on the same channel, then data entry CC 6 and CC 38 is sent
+ * @param	paramNum - 14-bit NRPN parameter number
+ * @param	val - 14-bit parameter value
+ * @param	chanNum - midi channel
+ * @param	lsbOnly - send only data entry LSB. Ignored if parameter number was changed
+ */
+void midiSendNrpn(uint16_t paramNum, uint16_t val, uint8_t chanNum, bool lsbOnly);
+
+/*
+ * @brief	Forget NRPN parameter selected by midiSendNrpn(), so next call selects it again.
+ *			Selection is forgotten automatically if NRPN or RPN number is sent by midiSendControlChange().
+ *			Call it after parameter selection is sent by other way, e.g. as raw bytes
+ */
+void midiInvalidateNrpn();
+
 /*
  * @brief	Send note on midi message
  * @param	noteNum - midi note number
@@ -73,6 +100,45 @@ void midiSendSysEx(uint16_t length, uint8_t* data);
  */
 void midiSendSysExManfId(uint32_t manfId, uint16_t length, uint8_t* data);
 
+/*
+ * @brief	Streaming system exclusive message. Payload is put directly to UART TX queue without intermediate buffer.
+ *			Call midiSysExBegin, then any number of midiSysExPut* functions, then midiSysExEnd.
+ *			Don't send other midi messages between begin and end
+ * @param	manfId - 3 byte format manufacturer id, see midiSendSysExManfId
+ */
+void midiSysExBegin(uint32_t manfId);
+
+/*
+ * @brief	Put one payload byte of streaming SysEx. Byte is sent as is, MSB must be 0
+ */
+void midiSysExPut(uint8_t data);
+
+/*
+ * @brief	Put 14-bit value as two 7-bit bytes, MSB first
+ */
+void midiSysExPut14(uint16_t value);
+
+/*
+ * @brief	Put block of payload bytes
+ */
+void midiSysExPutBlock(const uint8_t* data, uint16_t length);
+
+/*
+ * @brief	Put null-terminated string including terminating null
+ */
+void midiSysExPutString(const char* str);
+
+/*
+ * @brief	Finish streaming SysEx, end byte (F7 hex) is sent
+ */
+void midiSysExEnd();
+
+/*
+ * @brief	Get number of bytes queued for sending. Use it to reduce output rate when link is busy,
+ *			at 31250 baud one byte takes 320us
+ */
+uint8_t midiGetTxQueueLength();
+
 /*
  * @brief	Read UART buffer and check midi messages. 
  *			Should be invoked in main loop. Running status is not supported in this version,
@@ -162,6 +228,15 @@ uint32_t midiGetSysExManufacturerId(uint8_t* sysEx);
 
 #define SYSEX_END		0xF7 //End of System exclusive message
 
+//Controllers with special meaning
+#define CC_14BIT_LSB_OFFSET	32 //LSB controller number of 14-bit CC is MSB controller number + 32
+#define CC_DATA_ENTRY_MSB	6
+#define CC_DATA_ENTRY_LSB	38
+#define CC_NRPN_LSB			98
+#define CC_NRPN_MSB			99
+#define CC_RPN_LSB			100
+#define CC_RPN_MSB			101
+
 //midi buffer size in bytes
 #define MIDI_BUFFER_SIZE	256
  
@@ -0,0 +1,49 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	onewire_async.h
+ * 
+ * @brief	Interrupt driven 1-wire engine for the serial number IC bus.
+ *			Every reset phase and bit slot is one Timer1 compare A step, so the CPU
+ *			is free between slots. Interrupts are disabled only inside the ISR
+ *			for the short low pulse and sample of a "1"/read slot (~15us).
+ *			Timer1 runs at 1 tick per microsecond, Timer1 compare A is used.
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+
+#ifndef ONEWIRE_ASYNC_H_
+#define ONEWIRE_ASYNC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Maximum bytes to write in one transaction (ROM command + function command + arguments)
+#define OW_ASYNC_WRITE_MAX 10
+
+/*
+ * @brief	Initialization of Timer1 and 1-wire pin. Must be called once before owAsyncStart
+ */
+void initOwAsync();
+
+/*
+ * @brief	Start transaction in background: bus reset, write writeLen bytes, then read readLen bytes
+ * @param	*writeData - bytes to send, copied to internal buffer, max OW_ASYNC_WRITE_MAX
+ * @param	writeLen - number of bytes to send
+ * @param	*readData - buffer for received bytes, must be valid until callback is called
+ * @param	readLen - number of bytes to receive
+ * @param	callback - called from ISR when transaction finished. ok is false if no presence pulse detected
+ *			or if other interrupts delayed timing critical step out of 1-wire limits, transaction may be retried.
+ *			Keep it short. May be NULL
+ * @return	false if engine is busy or writeLen is too long, true if transaction is started
+ */
+bool owAsyncStart(const uint8_t* writeData, uint8_t writeLen, uint8_t* readData, uint8_t readLen, void (*callback)(bool ok));
+
+/*
+ * @brief	Check if transaction is in progress
+ * @return	true if engine is busy
+ */
+bool owAsyncIsBusy();
+
+#endif /* ONEWIRE_ASYNC_H_ */
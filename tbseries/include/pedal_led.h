@@ -13,9 +13,18 @@
 #define PEDAL_LED_H_
 
 #include "pinout.h"
+#include "expression.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+//Auto flush period, ms
+#ifndef PEDAL_LED_AUTO_FLUSH_PERIOD_MS
+#	define PEDAL_LED_AUTO_FLUSH_PERIOD_MS 20
+#endif
+
+//Bar graph resolution, one segment is one LED
+#define PEDAL_BAR_SEGMENTS PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM
+
 typedef enum PedalLedColor
 {
 		PEDAL_COLOR_NO
@@ -37,10 +46,28 @@ typedef enum PedalLedColor
 void initPedalLed();
 
 /*
- * Send data from internal buffer to shift register
+ * Send data from internal buffer to shift register. Nothing is sent if data is not changed since last sending.
+ * Does nothing in auto flush mode, buffer is sent by timer. While any LED is animated, buffer is 
+ * committed to animation engine instead, after ledPedalEndUpdate() if update is in progress
  */
 void ledPedalSend();
 
+/*
+ * Enable or disable auto flush. In this mode buffer is sent from timer interrupt every 
+ * PEDAL_LED_AUTO_FLUSH_PERIOD_MS if it was changed, so many ledSetPedalColor() calls are batched to one transfer
+ */
+void ledPedalSetAutoFlush(bool enable);
+
+/*
+ * Hold auto flush and animation commit while several LEDs are changed. Calls may be nested, each call must be paired with ledPedalEndUpdate()
+ */
+void ledPedalBeginUpdate();
+
+/*
+ * Release auto flush held by ledPedalBeginUpdate()
+ */
+void ledPedalEndUpdate();
+
 
 /*
  * @brief	Set single LED color in internal buffer and optionally send it to shift register
@@ -70,6 +97,52 @@ void ledSetPedalColor(uint8_t ledNum, PedalLedColor color, bool send);
  */
 void ledSetPedalColorAll(PedalLedColor color, bool send);
 
+/*
+ * @brief	Blink pedal LED from timer interrupt, see led_anim.h. Overrides ledSetPedalColor() for this LED
+ *			until ledStopPedalAnimation()
+ * @param	periodMs -	blink period, up to 2550 ms
+ */
+void ledSetPedalBlink(uint8_t ledNum, PedalLedColor color, uint16_t periodMs);
+
+/*
+ * @brief	Smoothly fade pedal LED in and out, see ledSetPedalBlink()
+ */
+void ledSetPedalPulse(uint8_t ledNum, PedalLedColor color, uint16_t periodMs);
 
+/*
+ * @brief	Show pedal LED with reduced brightness
+ * @param	level -		brightness, 0..LED_ANIM_MAX_LEVEL
+ */
+void ledSetPedalBrightness(uint8_t ledNum, PedalLedColor color, uint8_t level);
+
+/*
+ * @brief	Return pedal LED to ledSetPedalColor() control
+ */
+void ledStopPedalAnimation(uint8_t ledNum);
+
+/*
+ * @brief	Set bar graph colors
+ * @param	rowColors -	PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM_IN_LINE colors, bottom row is first.
+ *						Default is green rows, two yellow rows and red top row
+ */
+void ledPedalBarSetZones(const PedalLedColor* rowColors);
+
+/*
+ * @brief	Show value as bar graph growing from the bottom row, left LED of row is lit first. 
+ *			Bar graph owns whole strip, patterns are precomputed, so this is single buffer copy.
+ *			Nothing is sent while displayed segments count is not changed
+ * @param	value -		0..127
+ */
+void ledPedalBarShow(uint8_t value);
+
+/*
+ * @brief	Show pedal position as bar graph from expProcess(), see expRegisterPedalDisplayCallback()
+ */
+void ledPedalBarAttach(PedalNumber pedalNumber);
+
+/*
+ * @brief	Stop showing pedal position
+ */
+void ledPedalBarDetach();
 
 #endif /* PEDAL_LED_H_ */
\ No newline at end of file
@@ -156,6 +156,10 @@
 #define LED_OE_PORT		PORTF
 #define LED_OE_PIN		5
 
+//Define LED_CHAIN_SPI and PEDAL_LED_CHAIN_SPI for boards where chain CLK is wired to SCK (PB1) 
+//and DATA to MOSI (PB2), chain will be sent by hardware SPI. See lldled.h
+//All TB series boards use general purpose pins for both chains, so software clocking is used
+
 //shift registers and LEDS description for LEDs on build in expression pedal
 #define PEDAL_LEDS_NUM 48
 #define PEDAL_REGS_NUM 6
@@ -2,7 +2,7 @@
  * BJ Devices Travel Box series midi controller library
  * @file	timer.h
  * 
- * @brief	provide timer ticks since last reset
+ * @brief	provide timer ticks and milliseconds since last reset
 			  
  *
  * Software is provided "as is" without express or implied warranty.
@@ -14,6 +14,11 @@
 #define timer_h_
 
 #include <stdint.h>
+#include <stdbool.h>
+
+//Maximum number of millisecond callbacks
+#define TIMER_MS_CALLBACKS_MAX 7
+
 /*
  * @brief	Timer initialization
  */
@@ -24,4 +29,22 @@ void initTimer();
  */
 uint32_t getTicks();
 
+/*
+ * @brief	Get milliseconds since last reset. Counter is driven by Timer2 compare interrupt
+ */
+uint32_t getMillis();
+
+/*
+ * @brief	Get microseconds since last reset, resolution is 8us at 8MHz. Overflows every 71 minutes, 
+ *			so use difference of two values only
+ */
+uint32_t getMicros();
+
+/*
+ * @brief	Register callback will invoked every millisecond from Timer2 interrupt. 
+ *			Callback must be short, it delays all other interrupts
+ * @return	false if there is no free slot, see TIMER_MS_CALLBACKS_MAX
+ */
+bool timerRegisterMsCallback(void (*callback)(void));
+
 #endif /* timer_h_ */
\ No newline at end of file
@@ -55,16 +55,29 @@
 #	define RX_BUFFER_SIZE0 256
 #endif
 
+// USART0 Transmitter buffer. Bytes are sent by interrupt, uart0PutChar() blocks only if buffer is full
+// User can redefine this value, maximum is 256
+#ifndef TX_BUFFER_SIZE0
+#	define TX_BUFFER_SIZE0 64
+#endif
+
 /*
  * @brief	USART0 init as midi port: baud 31250, 8 data, 1 stop, no parity, async mode
  */
 void initUart0AsMidi();
 
 /*
- * @brief	Send byte to USART0
+ * @brief	Send byte to USART0. Byte is queued to transmitter buffer. 
+ *			Blocking call if buffer is full. If global interrupts are disabled (e.g. in interrupt handler), 
+ *			queued bytes and this one are sent by polling, call blocks until they are sent
  */
 void uart0PutChar(uint8_t data);
 
+/*
+ * @brief	Get number of bytes in USART0 transmitter buffer, which are waiting for sending
+ */
+uint8_t uart0GetTxQueueLength();
+
 /*
  * @brief	Get char from USART0. Blocking call
  */
@@ -17,18 +17,63 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define UNIQ_ID_SIZE 8//7 bytes data + 1 byte CRC
+
+//Background read is repeated on failure, it may be broken by long interrupts of other modules
+#ifndef UNIQ_ID_READ_ATTEMPTS
+#	define UNIQ_ID_READ_ATTEMPTS 5
+#endif
+
+//State of ID cache
+typedef enum UniqIdStatus
+{
+	UNIQ_ID_UNKNOWN = 0,	//No valid cached ID, read from DS2411 is in progress
+	UNIQ_ID_CACHED,			//ID is loaded from EEPROM, not verified with DS2411 yet
+	UNIQ_ID_VERIFIED,		//ID is read from DS2411 and matched cached ID
+	UNIQ_ID_UPDATED,		//ID is read from DS2411 and differs from cached ID. Cache is rewritten
+	UNIQ_ID_NOT_AVAILABLE	//DS2411 not responded or CRC error on UNIQ_ID_READ_ATTEMPTS reads. Gen1 devices have no DS2411
+}UniqIdStatus;
+
 /*
- * @brief	Initialization of 1-wire interface
+ * @brief	Initialization of 1-wire interface. Loads cached ID from EEPROM.
+ *			If there is no valid cached ID, background read is started. Does not wait for 1-wire.
+ *			Interrupts must be enabled to complete background read
  */
 void initUniqId();
 
 /*
- * @brief	Read ID from DS2411
+ * @brief	Read ID from DS2411. Blocking, takes about 6ms. Cache is updated on success
  * @param 	*buffer - pointer to buffer for read data. 8 bytes is required
  * @return	true if ID was successfully read and CRC matched, false otherwise
  */
 bool uniqIdGet(uint8_t* buffer);
 
+/*
+ * @brief	Get cached ID. Constant time, no 1-wire access
+ * @param 	*buffer - pointer to buffer for ID. UNIQ_ID_SIZE bytes is required
+ * @return	true if valid ID is available, false otherwise
+ */
+bool uniqIdGetCached(uint8_t* buffer);
+
+/*
+ * @brief	Start background read of DS2411 to verify cached ID.
+ *			Cached ID may be copied to EEPROM of another device, so verify it before trust it
+ * @return	false if 1-wire engine is busy
+ */
+bool uniqIdStartVerify();
+
+/*
+ * @brief	Finish background read: check CRC, compare with cache and update EEPROM if needed.
+ *			Call it in main loop
+ */
+void uniqIdProcess();
+
+/*
+ * @brief	Get state of ID cache
+ * @return	see UniqIdStatus
+ */
+UniqIdStatus uniqIdGetStatus();
+
 
 
 #endif /* UNIQUEID_H_ */
\ No newline at end of file
@@ -10,9 +10,36 @@
 
 #include "adc.h"
 #include "log.h"
+#include "timer.h"
 #include <util/delay.h>
+#include <util/atomic.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
 
+//ADC clock 125 KHz for free running scan, it is still in 50..200 KHz range required for 10-bit resolution.
+//Conversion takes 13 ADC cycles, so new sample is ready every 104us
+#define ADC_SCAN_PRESCALER_BITS ((1 << ADPS2) | (1 << ADPS1))
+
+//Conversions discarded after mux change: one is already running on the old channel,
+//the next one is the first on new channel, it is taken while high impedance pulled-up input settles
+#define ADC_SCAN_DISCARD_NUM 2
+
+static uint8_t scanChannels[ADC_SCAN_MAX_CHANNELS];
+static uint8_t scanChannelsNum;
+static uint8_t scanIndex;
+static uint8_t scanDiscardCnt;
+static uint16_t scanAccumulator;
+static uint8_t scanSamplesCnt;
+static volatile uint8_t scanEnabled;
+static uint8_t scanRotationCnt;
+//ADC is stopped between probe rotations while all channels are disabled
+static volatile bool scanPaused;
+static bool probeTimerRegistered;
+static uint8_t probeIdleMs;
+
+static volatile uint16_t scanResults[ADC_SCAN_MAX_CHANNELS];
+static volatile uint8_t scanUpdates;
 
 
 void initAdc()
@@ -32,4 +59,155 @@ uint8_t adcRead8MsbBit(uint8_t chanNum)
 	while ((ADCSRA & 0x10)==0);
 	ADCSRA|=0x10;
 	return ADCH;
-}
\ No newline at end of file
+}
+
+//Start conversions from the first channel with probe rotation, so all channels are converted
+static void restartScan()
+{
+	scanIndex = 0;
+	scanAccumulator = 0;
+	scanSamplesCnt = 0;
+	scanRotationCnt = 0;
+	scanPaused = false;
+	//conversions after ADC enable are taken while input settles too
+	scanDiscardCnt = ADC_SCAN_DISCARD_NUM;
+	
+	ADMUX = scanChannels[0] | (ADC_SCAN_VREF_TYPE & 0xff);
+	ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADFR) | (1 << ADIE) | ADC_SCAN_PRESCALER_BITS;
+}
+
+//Paced probe of disabled channels while ADC is stopped
+static void probeTimerCallback()
+{
+	if(!scanPaused)
+		return;
+	
+	if(++probeIdleMs < ADC_SCAN_IDLE_PROBE_MS)
+		return;
+	
+	probeIdleMs = 0;
+	restartScan();
+}
+
+void adcStartScan(const uint8_t* channels, uint8_t channelsNum)
+{
+	uint8_t i;
+	
+	if(channelsNum == 0)
+		return;
+	if(channelsNum > ADC_SCAN_MAX_CHANNELS)
+		channelsNum = ADC_SCAN_MAX_CHANNELS;
+	
+	//stop conversions before scan list changing
+	ADCSRA = 0;
+	
+	for(i = 0; i < channelsNum; ++i)
+		scanChannels[i] = channels[i];
+	
+	scanChannelsNum = channelsNum;
+	scanUpdates = 0;
+	scanEnabled = 0xFF;
+	
+	if(!probeTimerRegistered)
+		probeTimerRegistered = timerRegisterMsCallback(probeTimerCallback);
+	
+	restartScan();
+}
+
+uint16_t adcGetScanResult(uint8_t chanIndex)
+{
+	uint16_t ret;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ret = scanResults[chanIndex];
+	}
+	return ret;
+}
+
+uint8_t adcGetScanUpdates()
+{
+	uint8_t ret;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ret = scanUpdates;
+		scanUpdates = 0;
+	}
+	return ret;
+}
+
+void adcSetScanEnabled(uint8_t enabledMask)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		scanEnabled = enabledMask;
+		if(scanPaused && enabledMask != 0)
+			restartScan();
+	}
+}
+
+//Find next channel to convert. All channels are included to each ADC_SCAN_PROBE_PERIOD rotation
+static uint8_t scanNextIndex()
+{
+	uint8_t index = scanIndex;
+	uint8_t i;
+	
+	for(i = 0; i < scanChannelsNum; ++i)
+	{
+		if(++index == scanChannelsNum)
+		{
+			index = 0;
+			if(++scanRotationCnt == ADC_SCAN_PROBE_PERIOD)
+				scanRotationCnt = 0;
+		}
+		
+		if(scanRotationCnt == 0 || (scanEnabled & (1 << index)))
+			break;
+	}
+	
+	return index;
+}
+
+//In free running mode next conversion is already started when interrupt occurs,
+//so new mux value is applied to the conversion after next one. 
+//Both of them are discarded: the running one belongs to the old channel, 
+//the first one on new channel replaces settling delay used by adcRead8MsbBit()
+ISR(ADC_vect)
+{
+	uint16_t result = ADCW;
+	uint8_t nextIndex;
+	
+	if(scanDiscardCnt)
+	{
+		--scanDiscardCnt;
+		return;
+	}
+	
+	scanAccumulator += result;
+	if(++scanSamplesCnt < ADC_OVERSAMPLING_SAMPLES)
+		return;
+	
+	//decimation
+	scanResults[scanIndex] = scanAccumulator >> ADC_OVERSAMPLING_BITS;
+	scanUpdates |= (1 << scanIndex);
+	scanAccumulator = 0;
+	scanSamplesCnt = 0;
+	
+	nextIndex = scanNextIndex();
+	if(scanEnabled == 0 && scanRotationCnt != 0 && probeTimerRegistered)
+	{
+		//probe rotation is finished, nothing to convert until next one
+		ADCSRA = 0;
+		scanPaused = true;
+		probeIdleMs = 0;
+		return;
+	}
+	
+	if(nextIndex == scanIndex)
+		return;//the only enabled channel, no need to switch
+	
+	scanIndex = nextIndex;
+	ADMUX = scanChannels[scanIndex] | (ADC_SCAN_VREF_TYPE & 0xff);
+	scanDiscardCnt = ADC_SCAN_DISCARD_NUM;
+}
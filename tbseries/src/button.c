@@ -15,106 +15,80 @@
 #include "timer.h"
 #include <stdint.h>
 #include <util/delay.h>
-#include <avr/pgmspace.h>
 
+//Buttons lists. Button number and pin name prefix, see portio.h
+//Port connection is differ on various models
 #ifdef TB_12_DEVICE
-
-const ioPort buttonsArray[FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM] PROGMEM = {
-	{ &KEY_1_PORT, KEY_1_PIN },
-	{ &KEY_2_PORT, KEY_2_PIN },
-	{ &KEY_3_PORT, KEY_3_PIN },
-	{ &KEY_4_PORT, KEY_4_PIN },
-	{ &KEY_5_PORT, KEY_5_PIN },
-	{ &KEY_6_PORT, KEY_6_PIN },
-	{ &KEY_7_PORT, KEY_7_PIN },
-	{ &KEY_8_PORT, KEY_8_PIN },
-	{ &KEY_9_PORT, KEY_9_PIN },
-	{ &KEY_10_PORT, KEY_10_PIN },
-	{ &KEY_11_PORT, KEY_11_PIN },
-	{ &KEY_12_PORT, KEY_12_PIN },
-
-	{ &KEY_INC_PORT, KEY_INC_PIN },
-	{ &KEY_DEC_PORT, KEY_DEC_PIN },
-	{ &KEY_UP_PORT, KEY_UP_PIN },
-	{ &KEY_DOWN_PORT, KEY_DOWN_PIN },
-	{ &KEY_LOAD_PORT, KEY_LOAD_PIN },
-	{ &KEY_SETUP_PORT, KEY_SETUP_PIN }};
+#	define FOOT_BUTTONS_LIST(X)	\
+		X(0, KEY_1)				\
+		X(1, KEY_2)				\
+		X(2, KEY_3)				\
+		X(3, KEY_4)				\
+		X(4, KEY_5)				\
+		X(5, KEY_6)				\
+		X(6, KEY_7)				\
+		X(7, KEY_8)				\
+		X(8, KEY_9)				\
+		X(9, KEY_10)			\
+		X(10, KEY_11)			\
+		X(11, KEY_12)
 
 #elif defined TB_5_DEVICE
- 
-//port connection is differ on various models
-const ioPort buttonsArray[FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM] PROGMEM = {
-	 { &KEY_1_PORT, KEY_1_PIN },
-	 { &KEY_2_PORT, KEY_2_PIN },
-	 { &KEY_3_PORT, KEY_3_PIN },
-	 { &KEY_6_PORT, KEY_6_PIN },
-	 { &KEY_4_PORT, KEY_4_PIN },
-
-	 { &KEY_INC_PORT, KEY_INC_PIN },
-	 { &KEY_DEC_PORT, KEY_DEC_PIN },
-	 { &KEY_UP_PORT, KEY_UP_PIN },
-	 { &KEY_DOWN_PORT, KEY_DOWN_PIN },
-	 { &KEY_LOAD_PORT, KEY_LOAD_PIN },
-	 { &KEY_SETUP_PORT, KEY_SETUP_PIN }};
-
+#	define FOOT_BUTTONS_LIST(X)	\
+		X(0, KEY_1)				\
+		X(1, KEY_2)				\
+		X(2, KEY_3)				\
+		X(3, KEY_6)				\
+		X(4, KEY_4)
 
 #elif defined TB_8_DEVICE
-const ioPort buttonsArray[FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM] PROGMEM = {
-	{ &KEY_2_PORT, KEY_2_PIN },
-	{ &KEY_3_PORT, KEY_3_PIN },
-	{ &KEY_5_PORT, KEY_5_PIN },
-	{ &KEY_6_PORT, KEY_6_PIN },
-	{ &KEY_7_PORT, KEY_7_PIN },
-	{ &KEY_8_PORT, KEY_8_PIN },
-	{ &KEY_10_PORT, KEY_10_PIN },
-	{ &KEY_11_PORT, KEY_11_PIN },
-
-	{ &KEY_INC_PORT, KEY_INC_PIN },
-	{ &KEY_DEC_PORT, KEY_DEC_PIN },
-	{ &KEY_UP_PORT, KEY_UP_PIN },
-	{ &KEY_DOWN_PORT, KEY_DOWN_PIN },
-	{ &KEY_LOAD_PORT, KEY_LOAD_PIN },
-	{ &KEY_SETUP_PORT, KEY_SETUP_PIN }};
+#	define FOOT_BUTTONS_LIST(X)	\
+		X(0, KEY_2)				\
+		X(1, KEY_3)				\
+		X(2, KEY_5)				\
+		X(3, KEY_6)				\
+		X(4, KEY_7)				\
+		X(5, KEY_8)				\
+		X(6, KEY_10)			\
+		X(7, KEY_11)
 
 #elif defined TB_6P_DEVICE
-const ioPort buttonsArray[FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM] PROGMEM = {
-	{ &KEY_1_PORT, KEY_1_PIN },
-	{ &KEY_2_PORT, KEY_2_PIN },
-	{ &KEY_3_PORT, KEY_3_PIN },
-	{ &KEY_6_PORT, KEY_6_PIN },
-	{ &KEY_4_PORT, KEY_4_PIN },
-	{ &KEY_UNDER_PEDAL_PORT, KEY_UNDER_PEDAL_PIN },
-
-	{ &KEY_INC_PORT, KEY_INC_PIN },
-	{ &KEY_DEC_PORT, KEY_DEC_PIN },
-	{ &KEY_UP_PORT, KEY_UP_PIN },
-	{ &KEY_DOWN_PORT, KEY_DOWN_PIN },
-	{ &KEY_LOAD_PORT, KEY_LOAD_PIN },
-	{ &KEY_SETUP_PORT, KEY_SETUP_PIN }};
+#	define FOOT_BUTTONS_LIST(X)	\
+		X(0, KEY_1)				\
+		X(1, KEY_2)				\
+		X(2, KEY_3)				\
+		X(3, KEY_6)				\
+		X(4, KEY_4)				\
+		X(5, KEY_UNDER_PEDAL)
 
 #elif defined TB_11P_DEVICE	
-const ioPort buttonsArray[FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM] PROGMEM = {
-	{ &KEY_1_PORT, KEY_1_PIN },
-	{ &KEY_2_PORT, KEY_2_PIN },
-	{ &KEY_3_PORT, KEY_3_PIN },
-	{ &KEY_5_PORT, KEY_5_PIN },
-	{ &KEY_6_PORT, KEY_6_PIN },
-	{ &KEY_7_PORT, KEY_7_PIN },
-	{ &KEY_8_PORT, KEY_8_PIN },
-	{ &KEY_9_PORT, KEY_9_PIN },
-	{ &KEY_10_PORT, KEY_10_PIN },
-	{ &KEY_11_PORT, KEY_11_PIN },
-	{ &KEY_UNDER_PEDAL_PORT, KEY_UNDER_PEDAL_PIN },
-
-	{ &KEY_INC_PORT, KEY_INC_PIN },
-	{ &KEY_DEC_PORT, KEY_DEC_PIN },
-	{ &KEY_UP_PORT, KEY_UP_PIN },
-	{ &KEY_DOWN_PORT, KEY_DOWN_PIN },
-	{ &KEY_LOAD_PORT, KEY_LOAD_PIN },
-	{ &KEY_SETUP_PORT, KEY_SETUP_PIN }};
+#	define FOOT_BUTTONS_LIST(X)	\
+		X(0, KEY_1)				\
+		X(1, KEY_2)				\
+		X(2, KEY_3)				\
+		X(3, KEY_5)				\
+		X(4, KEY_6)				\
+		X(5, KEY_7)				\
+		X(6, KEY_8)				\
+		X(7, KEY_9)				\
+		X(8, KEY_10)			\
+		X(9, KEY_11)			\
+		X(10, KEY_UNDER_PEDAL)
 			 
 #endif
 
+//Common for all models
+#define CONF_BUTTONS_LIST(X)				\
+	X(FOOT_BUTTONS_NUM, KEY_INC)			\
+	X(FOOT_BUTTONS_NUM + 1, KEY_DEC)		\
+	X(FOOT_BUTTONS_NUM + 2, KEY_UP)			\
+	X(FOOT_BUTTONS_NUM + 3, KEY_DOWN)		\
+	X(FOOT_BUTTONS_NUM + 4, KEY_LOAD)		\
+	X(FOOT_BUTTONS_NUM + 5, KEY_SETUP)
+
+#define BUTTON_INIT(num, name)	IO_INIT_INPUT(name, 1);
+#define BUTTON_READ(num, name)	case (num) : return IO_GET(name);
+
 
 #define DEBOUNCE_DELAY_MS	2
 #define KEY_ACTIVE			0
@@ -125,16 +99,23 @@ const ioPort buttonsArray[FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM] PROGMEM = {
 #define FIRST_AUTO_TIME		20
 #define HOLD_ON_TIME		25
 
+//Each case is a single pin test, see portio.h
+static uint8_t readButton(uint8_t buttonNum)
+{
+	switch(buttonNum)
+	{
+		FOOT_BUTTONS_LIST(BUTTON_READ)
+		CONF_BUTTONS_LIST(BUTTON_READ)
+		default : return !KEY_ACTIVE;
+	}
+}
+
 uint8_t getButtonState(uint8_t buttonNum)
 {
-    ioPort tmpPort;
-	tmpPort.pin_ = pgm_read_byte(&(buttonsArray[buttonNum].pin_));
-	tmpPort.portReg_ = (volatile uint8_t*)pgm_read_word(&(buttonsArray[buttonNum].portReg_));
-	
-	if(inputGet(&tmpPort) == KEY_ACTIVE)
+	if(readButton(buttonNum) == KEY_ACTIVE)
 	{
 		_delay_ms(DEBOUNCE_DELAY_MS);
-			return inputGet(&tmpPort);
+			return readButton(buttonNum);
 	}
 	
 	return !KEY_ACTIVE;
@@ -148,13 +129,12 @@ static uint32_t autorepeatCounter[FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM];
 void initButtons()
 {
 	uint8_t i;
-	ioPort tmpPort;
+	
+	FOOT_BUTTONS_LIST(BUTTON_INIT)
+	CONF_BUTTONS_LIST(BUTTON_INIT)
+	
 	for (i = 0; i < FOOT_BUTTONS_NUM + CONF_BUTTONS_NUM; ++i)
 	{
-		tmpPort.pin_ = pgm_read_byte(&(buttonsArray[i].pin_));
-		tmpPort.portReg_ = (volatile uint8_t*)pgm_read_word(&(buttonsArray[i].portReg_));
-		
-		initInput(&tmpPort, 1);
 		buttonsLastAction[i] = BUTTON_RELEASE; 
 		buttonsLastTime[0] = 0;
 		autorepeatCounter[0] = 0;
@@ -0,0 +1,69 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	exp_curves.c
+ * 
+ * @brief	Expression pedal response curves lookup tables
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "exp_curves.h"
+#include <avr/pgmspace.h>
+
+//Logarithmic curve y = log10(1 + 9x). Fast rise at heel position
+const uint8_t expCurveLog[EXP_CURVE_TABLE_SIZE] PROGMEM = {
+	  0,   4,   8,  11,  15,  18,  21,  24,  28,  31,  33,  36,  39,  42,  44,  47,
+	 50,  52,  55,  57,  59,  61,  64,  66,  68,  70,  72,  74,  76,  78,  80,  82,
+	 84,  86,  87,  89,  91,  93,  94,  96,  98,  99, 101, 102, 104, 105, 107, 108,
+	110, 111, 113, 114, 116, 117, 118, 120, 121, 122, 124, 125, 126, 127, 129, 130,
+	131, 132, 133, 135, 136, 137, 138, 139, 140, 141, 142, 144, 145, 146, 147, 148,
+	149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159, 160, 160, 161, 162, 163,
+	164, 165, 166, 167, 168, 168, 169, 170, 171, 172, 173, 174, 174, 175, 176, 177,
+	178, 178, 179, 180, 181, 181, 182, 183, 184, 184, 185, 186, 187, 187, 188, 189,
+	190, 190, 191, 192, 192, 193, 194, 194, 195, 196, 196, 197, 198, 198, 199, 200,
+	200, 201, 202, 202, 203, 204, 204, 205, 205, 206, 207, 207, 208, 208, 209, 210,
+	210, 211, 211, 212, 213, 213, 214, 214, 215, 215, 216, 217, 217, 218, 218, 219,
+	219, 220, 220, 221, 221, 222, 222, 223, 224, 224, 225, 225, 226, 226, 227, 227,
+	228, 228, 229, 229, 230, 230, 231, 231, 232, 232, 233, 233, 234, 234, 235, 235,
+	235, 236, 236, 237, 237, 238, 238, 239, 239, 240, 240, 241, 241, 241, 242, 242,
+	243, 243, 244, 244, 244, 245, 245, 246, 246, 247, 247, 247, 248, 248, 249, 249,
+	250, 250, 250, 251, 251, 252, 252, 252, 253, 253, 254, 254, 254, 255, 255, 255};
+
+//Exponential (audio taper) curve y = (10^x - 1) / 9. Slow rise at heel position
+const uint8_t expCurveExp[EXP_CURVE_TABLE_SIZE] PROGMEM = {
+	  0,   0,   1,   1,   1,   1,   2,   2,   2,   2,   3,   3,   3,   4,   4,   4,
+	  4,   5,   5,   5,   6,   6,   6,   7,   7,   7,   7,   8,   8,   8,   9,   9,
+	  9,  10,  10,  11,  11,  11,  12,  12,  12,  13,  13,  13,  14,  14,  15,  15,
+	 15,  16,  16,  17,  17,  17,  18,  18,  19,  19,  19,  20,  20,  21,  21,  22,
+	 22,  23,  23,  24,  24,  24,  25,  25,  26,  26,  27,  27,  28,  28,  29,  29,
+	 30,  30,  31,  32,  32,  33,  33,  34,  34,  35,  35,  36,  37,  37,  38,  38,
+	 39,  40,  40,  41,  41,  42,  43,  43,  44,  45,  45,  46,  47,  47,  48,  49,
+	 49,  50,  51,  52,  52,  53,  54,  55,  55,  56,  57,  58,  58,  59,  60,  61,
+	 62,  62,  63,  64,  65,  66,  66,  67,  68,  69,  70,  71,  72,  73,  74,  74,
+	 75,  76,  77,  78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,
+	 92,  93,  94,  95,  96,  97,  98,  99, 100, 102, 103, 104, 105, 106, 108, 109,
+	110, 111, 113, 114, 115, 116, 118, 119, 120, 122, 123, 124, 126, 127, 129, 130,
+	132, 133, 134, 136, 137, 139, 140, 142, 143, 145, 147, 148, 150, 151, 153, 155,
+	156, 158, 160, 161, 163, 165, 167, 168, 170, 172, 174, 175, 177, 179, 181, 183,
+	185, 187, 189, 191, 193, 195, 197, 199, 201, 203, 205, 207, 209, 211, 213, 216,
+	218, 220, 222, 225, 227, 229, 232, 234, 236, 239, 241, 243, 246, 248, 251, 253};
+
+//S-curve y = 3x^2 - 2x^3. Fine control near both ends of pedal travel
+const uint8_t expCurveS[EXP_CURVE_TABLE_SIZE] PROGMEM = {
+	  0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,   1,   2,   2,   2,   3,
+	  3,   3,   4,   4,   4,   5,   5,   6,   6,   7,   7,   8,   9,   9,  10,  10,
+	 11,  12,  12,  13,  14,  14,  15,  16,  17,  18,  18,  19,  20,  21,  22,  23,
+	 24,  25,  25,  26,  27,  28,  29,  30,  31,  32,  33,  35,  36,  37,  38,  39,
+	 40,  41,  42,  43,  45,  46,  47,  48,  49,  51,  52,  53,  54,  56,  57,  58,
+	 59,  61,  62,  63,  65,  66,  67,  69,  70,  71,  73,  74,  75,  77,  78,  80,
+	 81,  82,  84,  85,  87,  88,  90,  91,  92,  94,  95,  97,  98, 100, 101, 103,
+	104, 106, 107, 109, 110, 112, 113, 115, 116, 118, 119, 121, 122, 124, 125, 127,
+	128, 129, 131, 132, 134, 135, 137, 138, 140, 141, 143, 144, 146, 147, 149, 150,
+	152, 153, 155, 156, 158, 159, 161, 162, 164, 165, 166, 168, 169, 171, 172, 174,
+	175, 176, 178, 179, 181, 182, 183, 185, 186, 187, 189, 190, 191, 193, 194, 195,
+	197, 198, 199, 200, 202, 203, 204, 205, 207, 208, 209, 210, 211, 213, 214, 215,
+	216, 217, 218, 219, 220, 221, 223, 224, 225, 226, 227, 228, 229, 230, 231, 231,
+	232, 233, 234, 235, 236, 237, 238, 238, 239, 240, 241, 242, 242, 243, 244, 244,
+	245, 246, 246, 247, 247, 248, 249, 249, 250, 250, 251, 251, 252, 252, 252, 253,
+	253, 253, 254, 254, 254, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255};
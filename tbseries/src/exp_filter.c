@@ -0,0 +1,161 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	exp_filter.c
+ * 
+ * @brief	Expression pedal input filter
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "exp_filter.h"
+
+void expFilterReset(const ExpFilterConfig* config, ExpFilterState* state, uint16_t value)
+{
+	uint8_t i;
+	
+	for(i = 0; i < EXP_FILTER_MEDIAN_MAX; ++i)
+		state->history_[i] = value;
+	
+	state->historyPos_ = 0;
+	state->emaSum_ = (uint32_t)value << config->emaShift_;
+	state->output_ = value;
+	state->rising_ = false;
+	state->lastInput_ = value;
+	state->inputRising_ = false;
+	state->noiseSum_ = 0;
+}
+
+static uint16_t median(const ExpFilterConfig* config, ExpFilterState* state, uint16_t input)
+{
+	uint16_t sorted[EXP_FILTER_MEDIAN_MAX];
+	uint16_t tmp;
+	uint8_t size = config->medianSize_;
+	uint8_t i;
+	uint8_t j;
+	
+	if(size <= 1)
+		return input;
+	
+	if(size > EXP_FILTER_MEDIAN_MAX)
+		size = EXP_FILTER_MEDIAN_MAX;
+	
+	state->history_[state->historyPos_] = input;
+	if(++state->historyPos_ >= size)
+		state->historyPos_ = 0;
+	
+	//insertion sort, there are 5 elements at most
+	for(i = 0; i < size; ++i)
+	{
+		tmp = state->history_[i];
+		for(j = i; j > 0 && sorted[j - 1] > tmp; --j)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = tmp;
+	}
+	
+	return sorted[size >> 1];
+}
+
+static uint16_t ema(const ExpFilterConfig* config, ExpFilterState* state, uint16_t input)
+{
+	uint16_t average;
+	
+	if(config->emaShift_ == 0)
+		return input;
+	
+	//sum is the average multiplied by 2^shift, so no fractional bits are lost and average reaches input exactly
+	average = state->emaSum_ >> config->emaShift_;
+	state->emaSum_ = state->emaSum_ - average + input;
+	return state->emaSum_ >> config->emaShift_;
+}
+
+//Jitter changes direction almost every sample, while pedal movement does not. So noise is an average 
+//of input steps which reverse direction, other steps decay it towards zero
+static uint32_t noiseBand(const ExpFilterConfig* config, ExpFilterState* state, uint16_t input)
+{
+	uint16_t step = 0;
+	
+	if(config->noiseGain_ == 0)
+		return config->deadband_;
+	
+	if(input > state->lastInput_)
+	{
+		if(!state->inputRising_)
+			step = input - state->lastInput_;
+		state->inputRising_ = true;
+	}
+	else if(input < state->lastInput_)
+	{
+		if(state->inputRising_)
+			step = state->lastInput_ - input;
+		state->inputRising_ = false;
+	}
+	state->lastInput_ = input;
+	
+	state->noiseSum_ = state->noiseSum_ - (state->noiseSum_ >> EXP_FILTER_NOISE_SHIFT) + step;
+	return config->deadband_ + (uint32_t)config->noiseGain_ * (state->noiseSum_ >> EXP_FILTER_NOISE_SHIFT);
+}
+
+static uint16_t deadband(const ExpFilterConfig* config, ExpFilterState* state, uint16_t input)
+{
+	uint32_t band = noiseBand(config, state, input);
+	
+	//moving in the same direction passes any change, reverse requires movement wider than deadband
+	if(state->rising_)
+	{
+		if(input >= state->output_)
+			state->output_ = input;
+		else if(input + band < state->output_)
+		{
+			state->rising_ = false;
+			state->output_ = input;
+		}
+	}
+	else
+	{
+		if(input <= state->output_)
+			state->output_ = input;
+		else if(input > state->output_ + band)
+		{
+			state->rising_ = true;
+			state->output_ = input;
+		}
+	}
+	
+	return state->output_;
+}
+
+uint16_t expFilterProcess(const ExpFilterConfig* config, ExpFilterState* state, uint16_t input)
+{
+	input = median(config, state, input);
+	input = ema(config, state, input);
+	return deadband(config, state, input);
+}
+
+uint16_t expFilterMeasure(const ExpFilterConfig* config, const uint16_t* trace, uint16_t len, uint8_t outputBits)
+{
+	ExpFilterState state;
+	uint8_t shift = 14 - outputBits;
+	uint16_t lastOutput;
+	uint16_t output;
+	uint16_t changes = 0;
+	uint16_t i;
+	
+	if(len == 0)
+		return 0;
+	
+	expFilterReset(config, &state, trace[0]);
+	lastOutput = state.output_ >> shift;
+	
+	for(i = 1; i < len; ++i)
+	{
+		output = expFilterProcess(config, &state, trace[i]) >> shift;
+		if(output != lastOutput)
+		{
+			lastOutput = output;
+			++changes;
+		}
+	}
+	
+	return changes;
+}
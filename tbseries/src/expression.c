@@ -12,16 +12,20 @@
 #include "adc.h"
 #include "pinout.h"
 #include "portio.h"
+#include "midi.h"
+#include "timer.h"
+#include "exp_curves.h"
+#include "exp_filter.h"
+#include "checksum.h"
 #include "log.h"
 #include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #define MAX_PEDALS 3
 
-const ioPort pedalsArray[MAX_PEDALS] PROGMEM = {
-	{ &EXP_P1_PORT, EXP_P1_PIN },
-	{ &EXP_P2_PORT, EXP_P2_PIN },
-	{ &EXP_P_OB_PORT, EXP_P_OB_PIN }};
-
 #define EXP_P1_ADC_CHAN EXP_P1_PIN
 #define EXP_P2_ADC_CHAN EXP_P2_PIN
 #define EXP_P_ONBPAR_ADC_CHAN EXP_P_OB_PIN
@@ -29,96 +33,765 @@ const ioPort pedalsArray[MAX_PEDALS] PROGMEM = {
 static const uint8_t adcChanArray[MAX_PEDALS] = {EXP_P1_ADC_CHAN, EXP_P2_ADC_CHAN, EXP_P_ONBPAR_ADC_CHAN};
 static uint8_t pedalsPrevValue[MAX_PEDALS] = {0, 0, 0};
 
+//Output to midi
+typedef struct PedalOutput
+{
+	ExpOutputMode mode_;
+	uint8_t chanNum_;
+	uint16_t ctrlNum_;
+	uint16_t lastValue_;	//14-bit value
+	bool sent_;				//false until first position is sent to output and mapped targets
+	//rate limit
+	uint16_t minInterval_;	//ms
+	uint16_t lastSendTime_;	//low bits of getMillis() are enough to measure interval
+	uint16_t pendingValue_;	//latest position, it replaces all values which were not sent
+	bool pending_;
+}PedalOutput;
+
+static PedalOutput pedalsOutput[MAX_PEDALS];
+
+//Presence detection
+static uint8_t pedalsConnected;//bit N is set if pedal N is plugged
+static uint8_t presenceDisabled;//bit N is set if detection is disabled for pedal N
+static uint16_t presenceCnt[MAX_PEDALS];//samples which are not agreed with current state
+static uint16_t presenceLastValue[MAX_PEDALS];//last raw value below rail of plugged pedal
+static uint8_t presenceToe;//bit N is set if pedal N moved to rail smoothly, it is toe position rather than unplug
+static uint16_t presenceToeStart[MAX_PEDALS];//getMillis() of first sample on rail at toe position
+
+//Pickup (soft takeover). Output is suppressed until pedal reaches value of target
+static uint8_t pickupEnabled;
+static uint8_t pickupWaiting;//bit N is set if pedal N output is suppressed
+static uint8_t pickupSideKnown;//pedal position relative to target is checked after pickup start
+static uint8_t pickupBelow;//bit N is set if pedal N position was below target
+static uint16_t pickupTarget[MAX_PEDALS];//14-bit
+
+//Mapping of pedals to targets. Stored in EEPROM
+typedef struct MappingsBlock
+{
+	ExpMapping mappings_[EXP_MAPPING_MAX];
+	uint16_t crc_;
+}MappingsBlock;
+
+static MappingsBlock eeMappings EEMEM;
+
+static ExpMapping mappings[EXP_MAPPING_MAX];
+static uint16_t mappingsLastValue[EXP_MAPPING_MAX];
+static uint8_t mappingsPedals;//bit N is set if pedal N has any mapping
+static void (*mappingSenders[EXP_TARGET_AXEFX - EXP_TARGET_KPA + 1])(uint16_t, uint16_t);
 
-//Use hysteresis function to avoid bouncing on the boundary of values
-static uint8_t direction[3] = {0,0,0};
-static const uint8_t threshold = 1;
-static uint16_t lastVal[3] = {0,0,0};
+//Calibration and response curve. Stored in EEPROM
+//Pedal travel limits are 16-bit values, it does not depend on ADC oversampling settings
+typedef struct PedalProfile
+{
+	uint16_t min_;
+	uint16_t max_;
+	uint8_t curve_;		//ExpCurve
+}PedalProfile;
+
+typedef struct PedalProfilesBlock
+{
+	PedalProfile profiles_[MAX_PEDALS];
+	uint16_t crc_;
+}PedalProfilesBlock;
+
+static PedalProfilesBlock eeProfiles EEMEM;
+static uint8_t eeCustomCurve[EXP_CURVE_TABLE_SIZE] EEMEM;
+
+static PedalProfile profiles[MAX_PEDALS];
+static uint16_t profilesScale[MAX_PEDALS];//(max - min) reciprocal, 8.8 fixed point. Avoids division per sample
+
+//Calibration mode
+static uint8_t calibrationMask;//bit N is set if pedal N is calibrating
+static uint16_t calibrationMin[MAX_PEDALS];
+static uint16_t calibrationMax[MAX_PEDALS];
+
+//Input filters
+static ExpFilterConfig filtersConfig[MAX_PEDALS];
+static ExpFilterState filtersState[MAX_PEDALS];
+static uint8_t filtersPrimed;//bit N is set if filter of pedal N got first sample
+static uint16_t filteredValue[MAX_PEDALS];//14-bit
+
+static void updateProfileScale(uint8_t pedalNumber)
+{
+	profilesScale[pedalNumber] = ((uint32_t)0xFFFF << 8) / (profiles[pedalNumber].max_ - profiles[pedalNumber].min_);
+}
+
+static void setDefaultProfile(uint8_t pedalNumber)
+{
+	profiles[pedalNumber].min_ = 0;
+	profiles[pedalNumber].max_ = 0xFFFF;
+	profiles[pedalNumber].curve_ = EXP_CURVE_LINEAR;
+}
+
+static void loadProfiles()
+{
+	PedalProfilesBlock block;
+	uint8_t i;
 	
-uint8_t hysteresis(uint8_t input, uint8_t channel)
+	eeprom_read_block(&block, &eeProfiles, sizeof(block));
+	if(block.crc_ == crc16Ccitt(&block.profiles_, sizeof(block.profiles_)))
+	{
+		for(i = 0; i < MAX_PEDALS; ++i)
+			profiles[i] = block.profiles_[i];
+	}
+	else
+	{
+		LOG(SEV_WARNING, "Pedals calibration not found");
+		for(i = 0; i < MAX_PEDALS; ++i)
+			setDefaultProfile(i);
+	}
+	
+	for(i = 0; i < MAX_PEDALS; ++i)
+		updateProfileScale(i);
+}
+
+void expSaveProfiles()
 {
-	if (direction[channel] == 0)//go down
+	PedalProfilesBlock block;
+	uint8_t i;
+	
+	for(i = 0; i < MAX_PEDALS; ++i)
+		block.profiles_[i] = profiles[i];
+	
+	block.crc_ = crc16Ccitt(&block.profiles_, sizeof(block.profiles_));
+	eeprom_update_block(&block, &eeProfiles, sizeof(block));
+}
+
+void expSetCustomCurve(const uint8_t* table)
+{
+	eeprom_update_block(table, eeCustomCurve, EXP_CURVE_TABLE_SIZE);
+}
+
+void expSetPedalCurve(PedalNumber pedalNumber, ExpCurve curve)
+{
+	profiles[pedalNumber].curve_ = curve;
+}
+
+void expCalibrationStart(PedalNumber pedalNumber)
+{
+	calibrationMin[pedalNumber] = 0xFFFF;
+	calibrationMax[pedalNumber] = 0;
+	calibrationMask |= (1 << pedalNumber);
+}
+
+bool expCalibrationStop(PedalNumber pedalNumber)
+{
+	uint16_t margin;
+	
+	if(!(calibrationMask & (1 << pedalNumber)))
+		return false;
+	
+	calibrationMask &= ~(1 << pedalNumber);
+	
+	if(calibrationMax[pedalNumber] < calibrationMin[pedalNumber]
+		|| calibrationMax[pedalNumber] - calibrationMin[pedalNumber] < EXP_CALIBRATION_MIN_TRAVEL)
 	{
-		if ((uint16_t)input > lastVal[channel] + threshold)
-		{
-			direction[channel] = 1;//go up
-			lastVal[channel] = (uint16_t)input;
-			return input;
-		}
-		else if((uint16_t)input < lastVal[channel])
-		{
-			lastVal[channel] = (uint16_t)input;
-			return input;
-		}
-		else
-		{
-			return lastVal[channel];
-		}
+		LOG(SEV_WARNING, "Pedal %d travel is too short", pedalNumber);
+		return false;//keep previous calibration
 	}
-	else//go up
+	
+	//Cut small margin on both ends, so pedal is able to reach 0 and max value for sure
+	margin = (calibrationMax[pedalNumber] - calibrationMin[pedalNumber]) >> EXP_CALIBRATION_MARGIN_SHIFT;
+	profiles[pedalNumber].min_ = calibrationMin[pedalNumber] + margin;
+	profiles[pedalNumber].max_ = calibrationMax[pedalNumber] - margin;
+	updateProfileScale(pedalNumber);
+	return true;
+}
+
+static uint8_t readCurveTable(uint8_t curve, uint8_t index)
+{
+	switch(curve)
 	{
-		if ((uint16_t)input < lastVal[channel] - threshold)
-		{
-			direction[channel] = 0;//go down
-			lastVal[channel] = (uint16_t)input;
-			return input;
-		}
-		else if(input >= (uint16_t)lastVal[channel])
-		{
-			lastVal[channel] = (uint16_t)input;
-			return input;
-		}
-		else
-		{
-			return lastVal[channel];
-		}
+		case EXP_CURVE_LOG :
+			return pgm_read_byte(&expCurveLog[index]);
+		
+		case EXP_CURVE_EXP :
+			return pgm_read_byte(&expCurveExp[index]);
+		
+		case EXP_CURVE_S :
+			return pgm_read_byte(&expCurveS[index]);
+		
+		case EXP_CURVE_CUSTOM :
+			return eeprom_read_byte(&eeCustomCurve[index]);
+		
+		default :
+			return index;
 	}
 }
+
+//Apply response curve to 16-bit value. Table lookup with linear interpolation between neighbour entries
+static uint16_t applyCurve(uint8_t curve, uint16_t value)
+{
+	uint16_t y0;
+	uint16_t y1;
+	uint8_t index;
+	uint8_t fraction;
+	
+	if(curve == EXP_CURVE_LINEAR)
+		return value;
+	
+	index = value >> 8;
+	fraction = (uint8_t)value;
+	y0 = readCurveTable(curve, index);
+	y1 = (index == EXP_CURVE_TABLE_SIZE - 1) ? EXP_CURVE_TABLE_END : readCurveTable(curve, index + 1);
+	
+	if(y1 >= y0)
+		value = (y0 << 8) + (y1 - y0) * fraction;
+	else
+		value = (y0 << 8) - (y0 - y1) * fraction;//custom curve may be not monotonic
+	
+	return value;
+}
+
+//Apply calibration and response curve to 16-bit value from ADC. Return 16-bit pedal position
+static uint16_t applyProfile(uint8_t pedalNumber, uint16_t value)
+{
+	PedalProfile* profile = &profiles[pedalNumber];
+	uint32_t scaled;
+	
+	//calibration
+	if(value <= profile->min_)
+		return 0;
+	if(value >= profile->max_)
+		return 0xFFFF;
+	
+	scaled = ((uint32_t)(value - profile->min_) * profilesScale[pedalNumber]) >> 8;
+	value = (scaled > 0xFFFF) ? 0xFFFF : (uint16_t)scaled;
+	
+	return applyCurve(profile->curve_, value);
+}
+
+static void updateMappingsPedals()
+{
+	uint8_t i;
+	
+	mappingsPedals = 0;
+	for(i = 0; i < EXP_MAPPING_MAX; ++i)
+	{
+		if(EXP_MAPPING_GET_TYPE(mappings[i].target_) != EXP_TARGET_NONE)
+			mappingsPedals |= (1 << EXP_MAPPING_GET_PEDAL(mappings[i].target_));
+	}
+}
+
+static void loadMappings()
+{
+	uint8_t i;
+	
+	eeprom_read_block(&mappings, &eeMappings.mappings_, sizeof(mappings));
+	if(eeprom_read_word(&eeMappings.crc_) != crc16Ccitt(&mappings, sizeof(mappings)))
+	{
+		for(i = 0; i < EXP_MAPPING_MAX; ++i)
+			mappings[i].target_ = EXP_TARGET_NONE;
+	}
+	
+	updateMappingsPedals();
+}
+
+void expSaveMappings()
+{
+	eeprom_update_block(&mappings, &eeMappings.mappings_, sizeof(mappings));
+	eeprom_update_word(&eeMappings.crc_, crc16Ccitt(&mappings, sizeof(mappings)));
+}
+
+void expSetMapping(uint8_t index, const ExpMapping* mapping)
+{
+	if(index >= EXP_MAPPING_MAX)
+		return;
 	
+	mappings[index] = *mapping;
+	updateMappingsPedals();
+	//new target gets current position
+	pedalsOutput[EXP_MAPPING_GET_PEDAL(mapping->target_)].sent_ = false;
+}
+
+void expRegisterMappingSender(ExpTargetType type, void (*sender)(uint16_t param, uint16_t value))
+{
+	if(type < EXP_TARGET_KPA || type > EXP_TARGET_AXEFX)
+		return;
+	
+	mappingSenders[type - EXP_TARGET_KPA] = sender;
+}
+
 void initExpression()
 {
 	uint8_t i;
-	ioPort tmpPort;
 	
 	initAdc();
 	
+	//LED_OE on PORTF is toggled from timer interrupt by LED autoflush
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		IO_INIT_INPUT(EXP_P1, 1);
+		IO_INIT_INPUT(EXP_P2, 1);
+		IO_INIT_INPUT(EXP_P_OB, 1);
+	}
+	
 	for(i = 0; i < MAX_PEDALS; ++i)
-	{	
-		tmpPort.pin_ = pgm_read_byte(&(pedalsArray[i].pin_));
-		tmpPort.portReg_ = (volatile uint8_t*)pgm_read_word(&(pedalsArray[i].portReg_));
-		initInput(&tmpPort, 1);
+	{
+		pedalsOutput[i].minInterval_ = EXP_OUTPUT_DEFAULT_INTERVAL;
+		filtersConfig[i].medianSize_ = EXP_FILTER_DEFAULT_MEDIAN;
+		filtersConfig[i].emaShift_ = EXP_FILTER_DEFAULT_EMA_SHIFT;
+		filtersConfig[i].deadband_ = EXP_FILTER_DEFAULT_DEADBAND;
+		filtersConfig[i].noiseGain_ = EXP_FILTER_DEFAULT_NOISE_GAIN;
+	}
+	
+	loadProfiles();
+	loadMappings();
+	
+#if defined (TB_6P_DEVICE) || defined(TB_11P_DEVICE)
+	//Onboard pedal is always present, its wiper may reach the rail at toe position
+	presenceDisabled = (1 << EXP_PEDAL_ONBOARD);
+	pedalsConnected = (1 << EXP_PEDAL_ONBOARD);
+#endif
+	
+	//pedals are sampled in background, see ADC_vect in adc.c
+	//External pedals are treated as unplugged until EXP_PRESENCE_WINDOW samples below rail are taken,
+	//scan of all channels is kept to find plugged pedals fast
+	adcStartScan(adcChanArray, MAX_PEDALS);
+}
+
+uint16_t expGetPedalRawValue(PedalNumber pedalNumber)
+{
+	//scale oversampled ADC value to 14 bit
+	return adcGetScanResult(pedalNumber) << (EXP_POSITION_14BIT_BITS - ADC_SCAN_RESULT_BITS);
+}
+
+uint16_t expGetPedalPosition14Bit(PedalNumber pedalNumber)
+{
+	uint16_t value = filteredValue[pedalNumber] << (16 - EXP_POSITION_14BIT_BITS);
+	return applyProfile(pedalNumber, value) >> (16 - EXP_POSITION_14BIT_BITS);
+}
+
+void expSetPedalFilter(PedalNumber pedalNumber, const ExpFilterConfig* config)
+{
+	filtersConfig[pedalNumber] = *config;
+	if(filtersConfig[pedalNumber].medianSize_ > EXP_FILTER_MEDIAN_MAX)
+		filtersConfig[pedalNumber].medianSize_ = EXP_FILTER_MEDIAN_MAX;
+	if(filtersConfig[pedalNumber].emaShift_ > EXP_FILTER_EMA_SHIFT_MAX)
+		filtersConfig[pedalNumber].emaShift_ = EXP_FILTER_EMA_SHIFT_MAX;
+	
+	filtersPrimed &= ~(1 << pedalNumber);//restart filter from next sample
+}
+
+static void updateFilter(uint8_t pedalNumber)
+{
+	uint16_t value = expGetPedalRawValue(pedalNumber);
+	
+	if(!(filtersPrimed & (1 << pedalNumber)))
+	{
+		expFilterReset(&filtersConfig[pedalNumber], &filtersState[pedalNumber], value);
+		filtersPrimed |= (1 << pedalNumber);
+		filteredValue[pedalNumber] = value;
+		return;
 	}
 	
+	filteredValue[pedalNumber] = expFilterProcess(&filtersConfig[pedalNumber], &filtersState[pedalNumber], value);
+}
+
+static void updateCalibration(uint8_t pedalNumber)
+{
+	uint16_t value = adcGetScanResult(pedalNumber) << (16 - ADC_SCAN_RESULT_BITS);
+	
+	if(value < calibrationMin[pedalNumber])
+		calibrationMin[pedalNumber] = value;
+	if(value > calibrationMax[pedalNumber])
+		calibrationMax[pedalNumber] = value;
 }
 
 uint8_t expGetPedalPosition(PedalNumber pedalNumber)
 {
-	//hysteresis working with values from 0 to 255, but pedal position in range from 0 to 127
-	return (hysteresis(adcRead8MsbBit(adcChanArray[pedalNumber]), pedalNumber)) >> 1;
+	//pedal position in range from 0 to 127
+	return expGetPedalPosition14Bit(pedalNumber) >> 7;
+}
+
+void expSetPedalOutput(PedalNumber pedalNumber, ExpOutputMode mode, uint16_t ctrlNum, uint8_t chanNum)
+{
+	pedalsOutput[pedalNumber].mode_ = mode;
+	pedalsOutput[pedalNumber].ctrlNum_ = ctrlNum;
+	pedalsOutput[pedalNumber].chanNum_ = chanNum;
+	pedalsOutput[pedalNumber].sent_ = false;
+}
+
+void expSetPedalRateLimit(PedalNumber pedalNumber, uint16_t minIntervalMs)
+{
+	pedalsOutput[pedalNumber].minInterval_ = minIntervalMs;
+}
+
+//Return true if message is sent
+static bool sendPedalOutput(uint8_t pedalNumber, uint16_t value)
+{
+	PedalOutput* output = &pedalsOutput[pedalNumber];
+	//LSB is enough if MSB is not changed since last message
+	bool lsbOnly = output->sent_ && ((output->lastValue_ >> 7) == (value >> 7));
+	
+	switch(output->mode_)
+	{
+		case EXP_OUTPUT_CC :
+			if(lsbOnly)
+				return false;//7-bit value is not changed
+			midiSendControlChange((uint8_t)output->ctrlNum_, (uint8_t)(value >> 7), output->chanNum_);
+			break;
+		
+		case EXP_OUTPUT_CC_14BIT :
+			midiSendControlChange14Bit((uint8_t)output->ctrlNum_, value, output->chanNum_, lsbOnly);
+			break;
+		
+		case EXP_OUTPUT_NRPN :
+			midiSendNrpn(output->ctrlNum_, value, output->chanNum_, lsbOnly);
+			break;
+		
+		default :
+			return false;
+	}
+	
+	output->lastValue_ = value;
+	return true;
+}
+
+//Scale 16-bit position to target range
+static uint16_t mapValue(const ExpMapping* mapping, uint16_t position)
+{
+	uint32_t range;
+	
+	if(mapping->options_ & EXP_MAPPING_INVERT)
+		position = ~position;
+	
+	position = applyCurve(EXP_MAPPING_GET_CURVE(mapping->options_), position);
+	
+	//0xFFFF is mapped to 0x10000, so max position gives exactly max value
+	range = (uint32_t)position + (position >> 15);
+	if(mapping->max_ >= mapping->min_)
+		return mapping->min_ + (uint16_t)(((mapping->max_ - mapping->min_) * range) >> 16);
+	else
+		return mapping->min_ - (uint16_t)(((mapping->min_ - mapping->max_) * range) >> 16);
+}
+
+//Send all targets of pedal which values are changed. Return true if anything is sent
+static bool sendMappings(uint8_t pedalNumber, uint16_t position, bool force)
+{
+	const ExpMapping* mapping;
+	uint16_t value;
+	bool lsbOnly;
+	bool sent = false;
+	uint8_t i;
+	
+	if(!(mappingsPedals & (1 << pedalNumber)))
+		return false;
+	
+	for(i = 0; i < EXP_MAPPING_MAX; ++i)
+	{
+		mapping = &mappings[i];
+		if(EXP_MAPPING_GET_PEDAL(mapping->target_) != pedalNumber)
+			continue;
+		
+		value = mapValue(mapping, position);
+		if(!force && value == mappingsLastValue[i])
+			continue;
+		
+		lsbOnly = !force && ((mappingsLastValue[i] >> 7) == (value >> 7));
+		switch(EXP_MAPPING_GET_TYPE(mapping->target_))
+		{
+			case EXP_TARGET_CC :
+				midiSendControlChange((uint8_t)mapping->param_, (uint8_t)value, EXP_MAPPING_GET_CHANNEL(mapping->options_));
+				break;
+			
+			case EXP_TARGET_CC_14BIT :
+				midiSendControlChange14Bit((uint8_t)mapping->param_, value, EXP_MAPPING_GET_CHANNEL(mapping->options_), lsbOnly);
+				break;
+			
+			case EXP_TARGET_NRPN :
+				midiSendNrpn(mapping->param_, value, EXP_MAPPING_GET_CHANNEL(mapping->options_), lsbOnly);
+				break;
+			
+			case EXP_TARGET_KPA :
+			case EXP_TARGET_AXEFX :
+				if(mappingSenders[EXP_MAPPING_GET_TYPE(mapping->target_) - EXP_TARGET_KPA] == NULL)
+					continue;
+				(*mappingSenders[EXP_MAPPING_GET_TYPE(mapping->target_) - EXP_TARGET_KPA])(mapping->param_, value);
+				break;
+			
+			default :
+				continue;
+		}
+		
+		mappingsLastValue[i] = value;
+		sent = true;
+	}
+	
+	return sent;
+}
+
+//Send latest position if interval since previous message is elapsed and midi link is not busy.
+//Intermediate values are dropped, the last one stays pending until it is sent
+static void processPedalOutput(uint8_t pedalNumber)
+{
+	PedalOutput* output = &pedalsOutput[pedalNumber];
+	uint16_t now;
+	uint16_t position16Bit;
+	bool sent;
+	
+	if(!output->pending_)
+		return;
+	
+	now = (uint16_t)getMillis();
+	if(output->sent_ && (uint16_t)(now - output->lastSendTime_) < output->minInterval_)
+		return;
+	
+	if(midiGetTxQueueLength() > EXP_OUTPUT_TX_QUEUE_LIMIT)
+		return;//back off, previous messages are still in the queue
+	
+	output->pending_ = false;
+	//both midi output and mapped targets are evaluated in one pass. Mappings use 16-bit position
+	sent = sendPedalOutput(pedalNumber, output->pendingValue_);
+	position16Bit = (output->pendingValue_ << (16 - EXP_POSITION_14BIT_BITS)) | (output->pendingValue_ >> (2*EXP_POSITION_14BIT_BITS - 16));
+	sent |= sendMappings(pedalNumber, position16Bit, !output->sent_);
+	
+	output->sent_ = true;
+	if(sent)
+		output->lastSendTime_ = now;
 }
 
 //callback
 static void (*posCallback)(PedalNumber, uint8_t);
+static void (*presenceCallback)(PedalNumber, bool);
+static void (*displayCallback)(PedalNumber, uint8_t);
 
 void expRegisterPedalChangePositionCallback(void (*callback)(PedalNumber pedalNumber, uint8_t position))
 {
 	posCallback = callback;
 }
 
-void expProcess()
+void expRegisterPedalPresenceCallback(void (*callback)(PedalNumber pedalNumber, bool connected))
+{
+	presenceCallback = callback;
+}
+
+void expRegisterPedalDisplayCallback(void (*callback)(PedalNumber pedalNumber, uint8_t position))
+{
+	displayCallback = callback;
+}
+
+bool expIsPedalConnected(PedalNumber pedalNumber)
+{
+	return pedalsConnected & (1 << pedalNumber);
+}
+
+static void setPedalConnected(uint8_t pedalNumber, bool connected)
+{
+	if(connected)
+	{
+		pedalsConnected |= (1 << pedalNumber);
+		//start from fresh state, current position will be sent
+		filtersPrimed &= ~(1 << pedalNumber);
+		pedalsOutput[pedalNumber].sent_ = false;
+	}
+	else
+	{
+		pedalsConnected &= ~(1 << pedalNumber);
+	}
+	
+	//unplugged pedals are only probed by ADC
+	adcSetScanEnabled(pedalsConnected);
+	presenceCnt[pedalNumber] = 0;
+}
+
+void expSetPresenceDetection(PedalNumber pedalNumber, bool enable)
+{
+	if(enable)
+	{
+		presenceDisabled &= ~(1 << pedalNumber);
+		return;
+	}
+	
+	presenceDisabled |= (1 << pedalNumber);
+	if(!expIsPedalConnected(pedalNumber))
+		setPedalConnected(pedalNumber, true);
+}
+
+//Return true if pedal is connected
+static bool updatePresence(uint8_t pedalNumber)
+{
+	bool connected = expIsPedalConnected(pedalNumber);
+	uint16_t value = expGetPedalRawValue(pedalNumber);
+	bool rail = value >= EXP_PRESENCE_RAIL_THRESHOLD;
+	uint8_t mask = (1 << pedalNumber);
+	
+	if(presenceDisabled & mask)
+		return true;
+	
+	if(rail != connected)
+	{
+		//sample agrees with current state
+		presenceCnt[pedalNumber] = 0;
+		if(connected)
+			presenceLastValue[pedalNumber] = value;
+		else
+			adcSetScanEnabled(pedalsConnected);//drop pedal from scan, it is in the scan after startup
+		return connected;
+	}
+	
+	//First sample on rail. Unplugged jack makes a jump from any position, 
+	//but pedal moving to toe position comes to rail from nearby values
+	if(connected && presenceCnt[pedalNumber] == 0)
+	{
+		if(presenceLastValue[pedalNumber] >= EXP_PRESENCE_TOE_THRESHOLD)
+		{
+			presenceToe |= mask;
+			presenceToeStart[pedalNumber] = (uint16_t)getMillis();
+		}
+		else
+		{
+			presenceToe &= ~mask;
+		}
+	}
+	
+	//at toe counter only marks started rail run. Channel takes at least 1.8ms, so it does not overflow in 60s
+	++presenceCnt[pedalNumber];
+	if(connected && (presenceToe & mask))
+	{
+		if((uint16_t)((uint16_t)getMillis() - presenceToeStart[pedalNumber]) < EXP_PRESENCE_TOE_WINDOW_MS)
+			return connected;
+	}
+	else if(presenceCnt[pedalNumber] < EXP_PRESENCE_WINDOW)
+	{
+		return connected;
+	}
+	
+	connected = !connected;
+	setPedalConnected(pedalNumber, connected);
+	LOG(SEV_INFO, "Pedal %d %s", pedalNumber, connected ? "plugged" : "unplugged");
+	if(presenceCallback)
+		(*presenceCallback)((PedalNumber)pedalNumber, connected);
+	
+	return connected;
+}
+
+void expSetPickupMode(PedalNumber pedalNumber, bool enable)
+{
+	if(enable)
+	{
+		pickupEnabled |= (1 << pedalNumber);
+	}
+	else
+	{
+		pickupEnabled &= ~(1 << pedalNumber);
+		pickupWaiting &= ~(1 << pedalNumber);
+	}
+}
+
+static uint16_t distance(uint16_t a, uint16_t b)
 {
-	if(!posCallback)
+	return (a > b) ? a - b : b - a;
+}
+
+void expPickupSetTargetValue(PedalNumber pedalNumber, uint16_t value)
+{
+	if(!(pickupEnabled & (1 << pedalNumber)))
+		return;
+	
+	pickupTarget[pedalNumber] = value;
+	//target already matches pedal, e.g. it is echo of own message
+	if(distance(expGetPedalPosition14Bit(pedalNumber), value) <= EXP_PICKUP_WINDOW)
 		return;
+	
+	pickupWaiting |= (1 << pedalNumber);
+	pickupSideKnown &= ~(1 << pedalNumber);
+	pedalsOutput[pedalNumber].pending_ = false;//position measured before target change must not overwrite it
+}
 
+bool expIsPickupWaiting(PedalNumber pedalNumber)
+{
+	return pickupWaiting & (1 << pedalNumber);
+}
+
+void expPickupProcessControlChange(uint8_t channel, uint8_t ccNum, uint8_t ccVal)
+{
+	PedalOutput* output;
 	uint8_t i;
-	uint8_t position;
+	
 	for(i = 0; i < MAX_PEDALS; ++i)
 	{
-		position = expGetPedalPosition(i);
-		if(position != pedalsPrevValue[i])
+		output = &pedalsOutput[i];
+		if(!(pickupEnabled & (1 << i)) || output->chanNum_ != channel)
+			continue;
+		
+		if((output->mode_ == EXP_OUTPUT_CC || output->mode_ == EXP_OUTPUT_CC_14BIT) && output->ctrlNum_ == ccNum)
+			expPickupSetTargetValue((PedalNumber)i, (uint16_t)ccVal << 7);
+		else if(output->mode_ == EXP_OUTPUT_CC_14BIT && output->ctrlNum_ + CC_14BIT_LSB_OFFSET == ccNum)
+			expPickupSetTargetValue((PedalNumber)i, (pickupTarget[i] & 0x3F80) | ccVal);
+	}
+}
+
+//Return true if output of pedal is allowed
+static bool updatePickup(uint8_t pedalNumber, uint16_t position)
+{
+	uint8_t mask = (1 << pedalNumber);
+	uint8_t below;
+	
+	if(!(pickupWaiting & mask))
+		return true;
+	
+	below = (position < pickupTarget[pedalNumber]) ? mask : 0;
+	if(!(pickupSideKnown & mask))
+	{
+		pickupSideKnown |= mask;
+		pickupBelow = (pickupBelow & ~mask) | below;
+	}
+	
+	//pedal is near to target or it has crossed target value since pickup start
+	if(distance(position, pickupTarget[pedalNumber]) > EXP_PICKUP_WINDOW && below == (pickupBelow & mask))
+		return false;
+	
+	pickupWaiting &= ~mask;
+	pedalsOutput[pedalNumber].pending_ = true;//target value is taken over, send position even if it is not changed
+	return true;
+}
+
+static void processPedalSample(uint8_t pedalNumber)
+{
+	uint16_t position14Bit;
+	uint8_t position;
+	
+	if(!updatePresence(pedalNumber))
+		return;
+	
+	if(calibrationMask & (1 << pedalNumber))
+		updateCalibration(pedalNumber);
+	
+	updateFilter(pedalNumber);
+	position14Bit = expGetPedalPosition14Bit(pedalNumber);
+	if((pedalsOutput[pedalNumber].mode_ != EXP_OUTPUT_NONE || (mappingsPedals & (1 << pedalNumber)))
+		&& updatePickup(pedalNumber, position14Bit))
+	{
+		if(!pedalsOutput[pedalNumber].sent_ || position14Bit != pedalsOutput[pedalNumber].pendingValue_)
 		{
-			pedalsPrevValue[i] = position;
-			(*posCallback)((PedalNumber)i, position);
+			pedalsOutput[pedalNumber].pendingValue_ = position14Bit;
+			pedalsOutput[pedalNumber].pending_ = true;
 		}
 	}
+	
+	position = position14Bit >> 7;
+	if(position != pedalsPrevValue[pedalNumber])
+	{
+		pedalsPrevValue[pedalNumber] = position;
+		if(displayCallback)
+			(*displayCallback)((PedalNumber)pedalNumber, position);
+		if(posCallback)
+			(*posCallback)((PedalNumber)pedalNumber, position);
+	}
 }
+
+void expProcess()
+{
+	uint8_t i;
+	uint8_t updates = adcGetScanUpdates();
+	for(i = 0; i < MAX_PEDALS; ++i)
+	{
+		if(updates & (1 << i))
+			processPedalSample(i);//new samples since last call
+		
+		//pending position is sent even if pedal is not moving anymore
+		if(!(pickupWaiting & (1 << i)))
+			processPedalOutput(i);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,168 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	fmt.c
+ * 
+ * @brief	Small numbers formatting without printf and division
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "fmt.h"
+
+#include <avr/pgmspace.h>
+#include <stdbool.h>
+
+static const uint16_t powersOfTen[] PROGMEM = {10000, 1000, 100, 10, 1};
+#define POWERS_NUM (sizeof(powersOfTen) / sizeof(powersOfTen[0]))
+
+static const char noteNames[] PROGMEM = "C C#D D#E F F#G G#A A#B ";
+
+//Write decimal digits, leading zeros are skipped, but at least minDigits are written
+static char* putDigits(char* buf, uint16_t value, uint8_t minDigits)
+{
+	uint16_t power;
+	uint8_t digit;
+	uint8_t i;
+	
+	for(i = 0; i < POWERS_NUM; ++i)
+	{
+		power = pgm_read_word(&powersOfTen[i]);
+		digit = '0';
+		while(value >= power)
+		{
+			value -= power;
+			++digit;
+		}
+		
+		if(digit != '0' || minDigits >= POWERS_NUM - i)
+		{
+			*buf++ = digit;
+			minDigits = POWERS_NUM;//all next digits are written
+		}
+	}
+	*buf = '\0';
+	return buf;
+}
+
+static uint8_t countDigits(uint16_t value)
+{
+	uint8_t i;
+	
+	for(i = 0; i < POWERS_NUM - 1; ++i)
+	{
+		if(value >= pgm_read_word(&powersOfTen[i]))
+			return POWERS_NUM - i;
+	}
+	return 1;
+}
+
+static char* putPadding(char* buf, uint8_t count, char pad)
+{
+	while(count--)
+		*buf++ = pad;
+	return buf;
+}
+
+static char* putSigned(char* buf, uint16_t absValue, bool negative, uint8_t minDigits, uint8_t width, char pad)
+{
+	uint8_t length = countDigits(absValue);
+	
+	if(length < minDigits)
+		length = minDigits;
+	if(negative)
+		++length;
+	
+	if(width > length && pad != '0')
+		buf = putPadding(buf, width - length, pad);
+	if(negative)
+		*buf++ = '-';
+	if(width > length && pad == '0')
+		buf = putPadding(buf, width - length, pad);
+	
+	return putDigits(buf, absValue, minDigits);
+}
+
+char* fmtUint(char* buf, uint16_t value, uint8_t width, char pad)
+{
+	return putSigned(buf, value, false, 1, width, pad);
+}
+
+char* fmtInt(char* buf, int16_t value, uint8_t width, char pad)
+{
+	uint16_t absValue = (value < 0) ? -(uint16_t)value : (uint16_t)value;
+	return putSigned(buf, absValue, value < 0, 1, width, pad);
+}
+
+static char hexDigit(uint8_t nibble)
+{
+	return (nibble < 10) ? '0' + nibble : 'A' - 10 + nibble;
+}
+
+char* fmtHex8(char* buf, uint8_t value)
+{
+	*buf++ = hexDigit(value >> 4);
+	*buf++ = hexDigit(value & 0x0F);
+	*buf = '\0';
+	return buf;
+}
+
+char* fmtHex16(char* buf, uint16_t value)
+{
+	buf = fmtHex8(buf, value >> 8);
+	return fmtHex8(buf, value & 0xFF);
+}
+
+char* fmtFixed(char* buf, int16_t value, uint8_t fracDigits, uint8_t width)
+{
+	uint16_t absValue = (value < 0) ? -(uint16_t)value : (uint16_t)value;
+	char* point;
+	char* end;
+	
+	//digits are written with point place reserved, then integer part is moved left
+	end = putSigned(buf, absValue, value < 0, fracDigits + 1, width ? width - 1 : 0, ' ');
+	point = end - fracDigits;
+	for(end[1] = '\0'; end != point; --end)
+		*end = *(end - 1);
+	*point = '.';
+	return point + fracDigits + 1;
+}
+
+char* fmtDb(char* buf, int16_t tenthsDb)
+{
+	if(tenthsDb > 0)
+		*buf++ = '+';
+	
+	buf = fmtFixed(buf, tenthsDb, 1, 0);
+	*buf++ = 'd';
+	*buf++ = 'B';
+	*buf = '\0';
+	return buf;
+}
+
+char* fmtNoteName(char* buf, uint8_t note)
+{
+	uint8_t octave = 0;
+	char c;
+	
+	while(note >= 12)
+	{
+		note -= 12;
+		++octave;
+	}
+	
+	*buf++ = pgm_read_byte(&noteNames[note * 2]);
+	c = pgm_read_byte(&noteNames[note * 2 + 1]);
+	if(c != ' ')
+		*buf++ = c;
+	
+	//midi octave numbering starts from -1
+	if(octave == 0)
+	{
+		*buf++ = '-';
+		*buf++ = '1';
+		*buf = '\0';
+		return buf;
+	}
+	return putDigits(buf, octave - 1, 1);
+}
@@ -10,40 +10,60 @@
 
 #include "led.h"
 #include "lldled.h"
+#include "timer.h"
+#include "led_anim.h"
 
 #include <avr/pgmspace.h>
 
+//Green and red pins of each LED
 #ifdef TB_12_DEVICE
-static const uint8_t ledsNumTable[TOTAL_LED_PINS] PROGMEM =  
-		{LED1_G, LED1_R, LED2_G, LED2_R, LED3_G, LED3_R, LED4_G, LED4_R, LED5_G, LED5_R, LED6_G, LED6_R,
-		LED7_G, LED7_R, LED8_G, LED8_R, LED9_G, LED9_R, LED10_G, LED10_R, LED11_G, LED11_R, LED12_G, LED12_R};
+#define LED_PINS_LIST(X) \
+		X(LED1_G, LED1_R) X(LED2_G, LED2_R) X(LED3_G, LED3_R) X(LED4_G, LED4_R) X(LED5_G, LED5_R) X(LED6_G, LED6_R) \
+		X(LED7_G, LED7_R) X(LED8_G, LED8_R) X(LED9_G, LED9_R) X(LED10_G, LED10_R) X(LED11_G, LED11_R) X(LED12_G, LED12_R)
 		
 #elif defined (TB_11P_DEVICE)
-static const uint8_t ledsNumTable[TOTAL_LED_PINS] PROGMEM = 
-		{LED1_G, LED1_R, LED2_G, LED2_R, LED3_G, LED3_R, LED5_G, LED5_R, LED6_G, LED6_R , LED7_G, LED7_R
-		,LED8_G, LED8_R, LED9_G, LED9_R, LED10_G, LED10_R, LED11_G, LED11_R
-		,LED4_G, LED4_R};//Dummy leds
+#define LED_PINS_LIST(X) \
+		X(LED1_G, LED1_R) X(LED2_G, LED2_R) X(LED3_G, LED3_R) X(LED5_G, LED5_R) X(LED6_G, LED6_R) X(LED7_G, LED7_R) \
+		X(LED8_G, LED8_R) X(LED9_G, LED9_R) X(LED10_G, LED10_R) X(LED11_G, LED11_R) \
+		X(LED4_G, LED4_R)//Dummy leds
 
 #elif defined (TB_5_DEVICE)
-static const uint8_t ledsNumTable[TOTAL_LED_PINS] PROGMEM = 
-		{LED1_G, LED1_R, LED2_G, LED2_R, LED3_G, LED3_R, LED6_G, LED6_R, LED4_G, LED4_R};
+#define LED_PINS_LIST(X) \
+		X(LED1_G, LED1_R) X(LED2_G, LED2_R) X(LED3_G, LED3_R) X(LED6_G, LED6_R) X(LED4_G, LED4_R)
 
 #elif defined (TB_6P_DEVICE)
-		static const uint8_t ledsNumTable[TOTAL_LED_PINS] PROGMEM =
-		{LED1_G, LED1_R, LED2_G, LED2_R, LED3_G, LED3_R, LED6_G, LED6_R, LED4_G, LED4_R
-		,LED8_G, LED8_R};//Dummy leds
+#define LED_PINS_LIST(X) \
+		X(LED1_G, LED1_R) X(LED2_G, LED2_R) X(LED3_G, LED3_R) X(LED6_G, LED6_R) X(LED4_G, LED4_R) \
+		X(LED8_G, LED8_R)//Dummy leds
 
 #elif defined (TB_8_DEVICE)
-		static const uint8_t ledsNumTable[TOTAL_LED_PINS] PROGMEM =
-		{LED2_G, LED2_R, LED3_G, LED3_R, LED5_G, LED5_R, LED6_G, LED6_R, LED7_G, LED7_R
-		,LED8_G, LED8_R, LED10_G, LED10_R, LED11_G, LED11_R};
+#define LED_PINS_LIST(X) \
+		X(LED2_G, LED2_R) X(LED3_G, LED3_R) X(LED5_G, LED5_R) X(LED6_G, LED6_R) X(LED7_G, LED7_R) \
+		X(LED8_G, LED8_R) X(LED10_G, LED10_R) X(LED11_G, LED11_R)
 
 #endif
 
+#define LED_PIN_NUMS(green, red) green, red,
+static const uint8_t ledsNumTable[TOTAL_LED_PINS] PROGMEM = {LED_PINS_LIST(LED_PIN_NUMS)};
+
+//Buffer byte and bit mask of both LED colors, so color is set by one or two masked writes
+typedef struct LedBits
+{
+	uint8_t greenReg_;
+	uint8_t greenMask_;
+	uint8_t redReg_;
+	uint8_t redMask_;
+}LedBits;
+
+#define LED_PIN_BITS(green, red) {LLDLED_REG(green), LLDLED_MASK(green), LLDLED_REG(red), LLDLED_MASK(red)},
+static const LedBits ledBitsTable[LEDS_NUM] PROGMEM = {LED_PINS_LIST(LED_PIN_BITS)};
+
 /*
  * prepare led interface
  */
 static uint8_t ledBuffer[REGS_NUM];
+static uint8_t greenPlane[REGS_NUM];//pins of all green LEDs in each register, for ledSetColorAll()
+static uint8_t redPlane[REGS_NUM];
 
 static const ioPort clkPort = {&LED_CLK_PORT, LED_CLK_PIN};
 static const ioPort dataPort = {&LED_DATA_PORT, LED_DATA_PIN};
@@ -51,9 +71,32 @@ static const ioPort oePort = {&LED_OE_PORT, LED_OE_PIN};
 
 //TODO place it to PROGMEM
 static RegsChainDescriptor chainDescriptors;
+static uint8_t sentBuffer[REGS_NUM];
+
+//Auto flush from timer interrupt
+static volatile bool autoFlush;
+static volatile uint8_t updateDepth;
+static bool autoFlushRegistered;
+static uint8_t autoFlushTimer;
+
+//Animation buffers
+static LedAnimState animStates[TOTAL_LED_PINS];
+static uint8_t animPlanes[LED_ANIM_PLANES_SIZE(REGS_NUM)];
+static uint8_t animMask[REGS_NUM];
+static uint8_t animFrame[REGS_NUM];
+static uint8_t animCommitted[REGS_NUM];
+static LedAnimChain animChain;
+static volatile bool commitHeld;//buffer is sent during update, snapshot is taken when update ends
+
+#ifndef LED_CHAIN_SPI
+LLDLED_DEFINE_BITBANG_SEND(chainSend, LED_CLK, LED_DATA)
+#endif
 
 void initLed()
 {
+	LedBits bits;
+	uint8_t i;
+	
 	initOutput(&clkPort, 0);
 	initOutput(&dataPort, 0);
 	initOutput(&oePort, 0);
@@ -64,51 +107,182 @@ void initLed()
 	chainDescriptors.data_ = &dataPort;
 	chainDescriptors.oe_ = &oePort;
 	chainDescriptors.buffer_ = ledBuffer;
+	chainDescriptors.sentBuffer_ = sentBuffer;
+	chainDescriptors.sentValid_ = false;
 	chainDescriptors.ledNumTable_ = (uint8_t*)&ledsNumTable;//data in PROGMEM!!
+#ifdef LED_CHAIN_SPI
+	chainDescriptors.transport_ = LLDLED_SPI;
+	lldLedInitSpi();
+#else
+	chainDescriptors.transport_ = LLDLED_BITBANG;
+	chainDescriptors.send_ = chainSend;
+#endif
+	
+	for(i = 0; i < LEDS_NUM; ++i)
+	{
+		memcpy_P(&bits, &ledBitsTable[i], sizeof(bits));
+		greenPlane[bits.greenReg_] |= bits.greenMask_;
+		redPlane[bits.redReg_] |= bits.redMask_;
+	}
+}
+
+static bool hasGreen(LedColor color)
+{
+	return color == COLOR_GREEN || color == COLOR_YELLOW;
+}
+
+static bool hasRed(LedColor color)
+{
+	return color == COLOR_RED || color == COLOR_YELLOW;
 }
 
 void ledSetColor(uint8_t ledNum, LedColor color, bool send)
 {
-    uint8_t phyLedNum = ledNum*2;//Number of GREEN physical led. Corresponding RED led will have phyLedNum+1
-    switch(color)
-    {
-	    case COLOR_BLACK :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_OFF);
-			break;
-	    
-	    case COLOR_GREEN :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_OFF);
-			break;
-	    
-	    case COLOR_RED :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_ON);
-			break;
-	    
-	    case COLOR_YELLOW :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_ON);
-			break;
-	    
-	    default : break;
+	LedBits bits;
+	uint8_t greenOn;
+	uint8_t redOn;
+	
+	if(color > COLOR_YELLOW)
+		return;
+	
+	memcpy_P(&bits, &ledBitsTable[ledNum], sizeof(bits));
+	greenOn = hasGreen(color) ? bits.greenMask_ : 0;
+	redOn = hasRed(color) ? bits.redMask_ : 0;
+	
+	if(bits.greenReg_ == bits.redReg_)
+	{
+		LLDLED_WRITE_BITS(ledBuffer, bits.greenReg_, bits.greenMask_ | bits.redMask_, greenOn | redOn);
 	}
+	else
+	{
+		LLDLED_WRITE_BITS(ledBuffer, bits.greenReg_, bits.greenMask_, greenOn);
+		LLDLED_WRITE_BITS(ledBuffer, bits.redReg_, bits.redMask_, redOn);
+	}
+	
 	if(send)
 		ledSend();	
 }
 
 void ledSetColorAll(LedColor color, bool send)
 {
+	uint8_t greenOn = hasGreen(color) ? 0xFF : 0;
+	uint8_t redOn = hasRed(color) ? 0xFF : 0;
 	uint8_t i;
-	for (i = 0; i < LEDS_NUM; ++i)
-		ledSetColor(i, color, false);
+	
+	if(color > COLOR_YELLOW)
+		return;
+	
+	for (i = 0; i < REGS_NUM; ++i)
+		LLDLED_WRITE_BITS(ledBuffer, i, greenPlane[i] | redPlane[i], (greenPlane[i] & greenOn) | (redPlane[i] & redOn));
 
 	if(send)
 		ledSend();	
 }
 
+//Animated chain is sent by timer, only snapshot of buffer is taken. Half-updated buffer is never committed
+static void sendChain()
+{
+	if(!chainDescriptors.animated_)
+	{
+		lldLedSend(&chainDescriptors);//nothing is sent if buffer is not changed
+		return;
+	}
+	
+	if(updateDepth == 0)
+		ledAnimCommit(&animChain);
+	else
+		commitHeld = true;
+}
+
+static void autoFlushCallback()
+{
+	if(!autoFlush || ++autoFlushTimer < LED_AUTO_FLUSH_PERIOD_MS)
+		return;
+	
+	autoFlushTimer = 0;
+	if(updateDepth == 0)
+		sendChain();
+}
+
+void ledSetAutoFlush(bool enable)
+{
+	if(enable && !autoFlushRegistered)
+		autoFlushRegistered = timerRegisterMsCallback(autoFlushCallback);
+	
+	autoFlush = enable && autoFlushRegistered;
+}
+
+void ledBeginUpdate()
+{
+	++updateDepth;
+}
+
+void ledEndUpdate()
+{
+	if(updateDepth > 0 && --updateDepth == 0 && commitHeld)
+	{
+		commitHeld = false;
+		if(chainDescriptors.animated_)
+			ledAnimCommit(&animChain);
+	}
+}
+
 void ledSend()
 {
-	lldLedSend(&chainDescriptors);
+	if(autoFlush)
+		return;//buffer will be sent by timer
+	
+	sendChain();
+}
+
+static void setAnimation(uint8_t ledNum, LedColor color, LedAnimMode mode, uint8_t level, uint16_t periodMs)
+{
+	uint8_t phyLedNum = ledNum*2;
+	
+	if(!chainDescriptors.animated_)
+	{
+		animChain.chain_ = &chainDescriptors;
+		animChain.leds_ = animStates;
+		animChain.planes_ = animPlanes;
+		animChain.mask_ = animMask;
+		animChain.frame_ = animFrame;
+		animChain.committed_ = animCommitted;
+		if(!ledAnimAttach(&animChain))
+			return;
+	}
+	
+	//color component which is not used is held off
+	if(color == COLOR_GREEN || color == COLOR_YELLOW)
+		ledAnimSet(&animChain, phyLedNum, mode, level, periodMs);
+	else
+		ledAnimSet(&animChain, phyLedNum, LED_ANIM_STEADY, 0, periodMs);
+	
+	if(color == COLOR_RED || color == COLOR_YELLOW)
+		ledAnimSet(&animChain, phyLedNum + 1, mode, level, periodMs);
+	else
+		ledAnimSet(&animChain, phyLedNum + 1, LED_ANIM_STEADY, 0, periodMs);
+}
+
+void ledSetBlink(uint8_t ledNum, LedColor color, uint16_t periodMs)
+{
+	setAnimation(ledNum, color, LED_ANIM_BLINK, LED_ANIM_MAX_LEVEL, periodMs);
+}
+
+void ledSetPulse(uint8_t ledNum, LedColor color, uint16_t periodMs)
+{
+	setAnimation(ledNum, color, LED_ANIM_PULSE, LED_ANIM_MAX_LEVEL, periodMs);
+}
+
+void ledSetBrightness(uint8_t ledNum, LedColor color, uint8_t level)
+{
+	setAnimation(ledNum, color, LED_ANIM_STEADY, level, 0);
+}
+
+void ledStopAnimation(uint8_t ledNum)
+{
+	if(!chainDescriptors.animated_)
+		return;
+	
+	ledAnimSet(&animChain, ledNum*2, LED_ANIM_NONE, 0, 0);
+	ledAnimSet(&animChain, ledNum*2 + 1, LED_ANIM_NONE, 0, 0);
 }
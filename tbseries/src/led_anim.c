@@ -0,0 +1,228 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	led_anim.c
+ * 
+ * @brief	LED animation engine over shift registers chains
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "led_anim.h"
+#include "timer.h"
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#include <string.h>
+
+static LedAnimChain* chains[LED_ANIM_CHAINS_MAX];
+static volatile uint8_t chainsNum;
+static bool callbackRegistered;
+static uint8_t animTicks;
+
+//Write brightness bits of LED to bit-planes
+static void setLevel(LedAnimChain* anim, uint8_t num, uint8_t level)
+{
+	uint8_t* plane = anim->planes_;
+	uint8_t i;
+	
+	anim->leds_[num].current_ = level;
+	for(i = 0; i < LED_ANIM_BRIGHTNESS_BITS; ++i)
+	{
+		lldLedSetValInBuffer(anim->chain_, plane, num, (level & 0x01) ? LED_ON : LED_OFF);
+		level >>= 1;
+		plane += anim->chain_->regsNum_;
+	}
+}
+
+static void setMask(LedAnimChain* anim, uint8_t num, bool animated)
+{
+	uint8_t pinNum = pgm_read_byte(&((anim->chain_->ledNumTable_)[num]));
+	
+	if(animated)
+		anim->mask_[pinNum >> 3] |= (1 << (pinNum & 0x07));
+	else
+		anim->mask_[pinNum >> 3] &= ~(1 << (pinNum & 0x07));
+}
+
+//Brightness of LED at current phase
+static uint8_t getLevel(const LedAnimState* led)
+{
+	uint8_t half = led->period_ >> 1;
+	uint8_t phase;
+	
+	switch(led->mode_)
+	{
+		case LED_ANIM_BLINK :
+			return (led->phase_ < half) ? led->level_ : 0;
+		
+		case LED_ANIM_PULSE :
+			phase = (led->phase_ < half) ? led->phase_ : led->period_ - led->phase_;
+			return ((uint16_t)phase * led->step_) >> 8;
+		
+		default :
+			return led->level_;
+	}
+}
+
+static void stepLeds(LedAnimChain* anim)
+{
+	LedAnimState* led = anim->leds_;
+	uint8_t level;
+	uint8_t i;
+	
+	for(i = 0; i < anim->chain_->ledsNum_; ++i, ++led)
+	{
+		if(led->mode_ != LED_ANIM_BLINK && led->mode_ != LED_ANIM_PULSE)
+			continue;
+		
+		if(++led->phase_ >= led->period_)
+			led->phase_ = 0;
+		
+		//bit-planes are updated only on brightness change
+		level = getLevel(led);
+		if(level != led->current_)
+			setLevel(anim, i, level);
+	}
+}
+
+//Compose frame from committed chain buffer and current bit-plane, then send it. Unchanged frame is not sent
+static void processChain(LedAnimChain* anim, bool step)
+{
+	uint8_t regsNum = anim->chain_->regsNum_;
+	const uint8_t* plane;
+	const uint8_t* buffer = anim->committed_;
+	uint8_t i;
+	
+	if(step)
+		stepLeds(anim);
+	
+	if(anim->planeTicks_ == 0)
+	{
+		if(++anim->plane_ == LED_ANIM_BRIGHTNESS_BITS)
+			anim->plane_ = 0;
+		anim->planeTicks_ = (1 << anim->plane_);
+	}
+	--anim->planeTicks_;
+	
+	plane = anim->planes_ + anim->plane_ * regsNum;
+	for(i = 0; i < regsNum; ++i)
+		anim->frame_[i] = (buffer[i] & ~anim->mask_[i]) | (plane[i] & anim->mask_[i]);
+	
+	lldLedSendData(anim->chain_, anim->frame_);
+}
+
+static void animCallback()
+{
+	uint8_t i;
+	bool step = false;
+	
+	if(++animTicks >= LED_ANIM_TICK_MS)
+	{
+		animTicks = 0;
+		step = true;
+	}
+	
+	for(i = 0; i < chainsNum; ++i)
+		processChain(chains[i], step);
+}
+
+bool ledAnimAttach(LedAnimChain* anim)
+{
+	uint8_t i;
+	
+	if(chainsNum == LED_ANIM_CHAINS_MAX)
+		return false;
+	
+	if(!callbackRegistered)
+	{
+		callbackRegistered = timerRegisterMsCallback(animCallback);
+		if(!callbackRegistered)
+			return false;
+	}
+	
+	for(i = 0; i < anim->chain_->regsNum_; ++i)
+		anim->mask_[i] = 0;
+	for(i = 0; i < anim->chain_->ledsNum_; ++i)
+		anim->leds_[i].mode_ = LED_ANIM_NONE;
+	
+	//not animated LEDs keep state which is shown now
+	if(anim->chain_->sentBuffer_ != NULL && anim->chain_->sentValid_)
+		memcpy(anim->committed_, anim->chain_->sentBuffer_, anim->chain_->regsNum_);
+	else
+		memcpy(anim->committed_, anim->chain_->buffer_, anim->chain_->regsNum_);
+	
+	anim->plane_ = LED_ANIM_BRIGHTNESS_BITS - 1;
+	anim->planeTicks_ = 0;
+	anim->chain_->animated_ = true;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		chains[chainsNum++] = anim;
+	}
+	return true;
+}
+
+void ledAnimCommit(LedAnimChain* anim)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy(anim->committed_, anim->chain_->buffer_, anim->chain_->regsNum_);
+	}
+}
+
+static bool isAnyAnimated(const LedAnimChain* anim)
+{
+	uint8_t i;
+	
+	for(i = 0; i < anim->chain_->regsNum_; ++i)
+	{
+		if(anim->mask_[i])
+			return true;
+	}
+	return false;
+}
+
+//Stop sending chain from timer interrupt. Must be called with interrupts disabled
+static void detach(LedAnimChain* anim)
+{
+	uint8_t i;
+	
+	for(i = 0; i < chainsNum && chains[i] != anim; ++i);
+	if(i == chainsNum)
+		return;
+	
+	for(--chainsNum; i < chainsNum; ++i)
+		chains[i] = chains[i + 1];
+	
+	anim->chain_->animated_ = false;
+	lldLedSendData(anim->chain_, anim->committed_);//last frame may contain animated LEDs
+}
+
+void ledAnimSet(LedAnimChain* anim, uint8_t num, LedAnimMode mode, uint8_t level, uint16_t periodMs)
+{
+	LedAnimState* led = &anim->leds_[num];
+	uint16_t period = periodMs / LED_ANIM_TICK_MS;
+	
+	if(level > LED_ANIM_MAX_LEVEL)
+		level = LED_ANIM_MAX_LEVEL;
+	if(period < 2)
+		period = 2;
+	if(period > 0xFF)
+		period = 0xFF;
+	//pulse falls from period/2 to 1, odd period would give one step above level
+	period &= ~1;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		led->mode_ = mode;
+		led->level_ = level;
+		led->period_ = (uint8_t)period;
+		led->phase_ = 0;
+		led->step_ = ((uint16_t)level << 8) / (period >> 1);
+		setLevel(anim, num, getLevel(led));
+		setMask(anim, num, mode != LED_ANIM_NONE);
+		if(mode == LED_ANIM_NONE && !isAnyAnimated(anim))
+			detach(anim);
+	}
+}
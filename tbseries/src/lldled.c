@@ -11,30 +11,114 @@
 #include "lldled.h"
 #include "pinout.h"
 
+#include <avr/io.h>
 #include <avr/pgmspace.h>
+#include <util/atomic.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 
-void lldLedSend(RegsChainDescriptor* interface)
+#define SPI_DDR	DDRB
+#define SPI_SCK_PIN		1
+#define SPI_MOSI_PIN	2
+
+void lldLedInitSpi()
+{
+	SPI_DDR |= (1 << SPI_SCK_PIN) | (1 << SPI_MOSI_PIN);
+	SPCR = (1 << SPE) | (1 << MSTR);//mode 0: data is latched by shift register on rising edge
+	SPSR = (1 << SPI2X);
+}
+
+//Registers are sent from last to first, MSB first. Port registers and masks are read once per chain
+static void sendBitBang(RegsChainDescriptor* interface, const uint8_t* data)
 {
+	volatile uint8_t* clkPort = interface->clk_->portReg_;
+	volatile uint8_t* dataPort = interface->data_->portReg_;
+	uint8_t clkMask = (1 << interface->clk_->pin_);
+	uint8_t dataMask = (1 << interface->data_->pin_);
+	const uint8_t* buffer = data + interface->regsNum_;
 	uint8_t i;
 	uint8_t j;
-
-	outputClear(interface->clk_);//clock falling edge
-	outputClear(interface->oe_);//set OE to low
+	uint8_t byte;
 	
 	for(i = 0; i < interface->regsNum_; i++)
 	{
+		byte = *(--buffer) ^ LLDLED_SEND_MASK;
 		for (j = 0; j < 8; j++)
 		{
-			outputClear(interface->clk_);//clock falling edge
-			outputSetToVal(interface->data_, (0x01 & (interface->buffer_[(interface->regsNum_ - 1) - i] >> (7-j)))^LED_ON);
-			outputSet(interface->clk_);//clock rising edge
+			*clkPort &= ~clkMask;//clock falling edge
+			if(byte & 0x80)
+				*dataPort |= dataMask;
+			else
+				*dataPort &= ~dataMask;
+			*clkPort |= clkMask;//clock rising edge
+			byte <<= 1;
 		}
 	}
-	outputSet(interface->oe_);//set OE to high
 }
 
-void lldLedSetVal(RegsChainDescriptor* interface, uint8_t num, uint8_t val)
+static void sendSpi(const uint8_t* data, uint8_t regsNum)
+{
+	const uint8_t* buffer = data + regsNum;
+	uint8_t i;
+	
+	for(i = 0; i < regsNum; i++)
+	{
+		SPDR = *(--buffer) ^ LLDLED_SEND_MASK;
+		while(!(SPSR & (1 << SPIF)));//16 CPU cycles per byte
+	}
+}
+
+bool lldLedIsDirty(const RegsChainDescriptor* interface)
+{
+	if(interface->sentBuffer_ == NULL || !interface->sentValid_)
+		return true;
+	
+	return memcmp(interface->sentBuffer_, interface->buffer_, interface->regsNum_) != 0;
+}
+
+void lldLedSendData(RegsChainDescriptor* interface, const uint8_t* data)
+{
+	if(interface->sentBuffer_ != NULL)
+	{
+		if(interface->sentValid_ && memcmp(interface->sentBuffer_, data, interface->regsNum_) == 0)
+			return;
+		
+		//snapshot is sent, so changes which are made during transmission are caught by next call
+		memcpy(interface->sentBuffer_, data, interface->regsNum_);
+		interface->sentValid_ = true;
+		data = interface->sentBuffer_;
+	}
+	
+	outputClear(interface->clk_);//clock falling edge
+	//OE shares PORTF with expression pedal pins, and chain is sent both from main loop and from timer interrupt
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		outputClear(interface->oe_);//set OE to low
+	}
+	
+	if(interface->transport_ == LLDLED_SPI)
+		sendSpi(data, interface->regsNum_);
+	else if(interface->send_ != NULL)
+		(*interface->send_)(data, interface->regsNum_);
+	else
+		sendBitBang(interface, data);
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		outputSet(interface->oe_);//set OE to high
+	}
+}
+
+void lldLedSend(RegsChainDescriptor* interface)
+{
+	if(interface->animated_)
+		return;//animation engine sends composed frames from timer interrupt
+	
+	lldLedSendData(interface, interface->buffer_);
+}
+
+void lldLedSetValInBuffer(RegsChainDescriptor* interface, uint8_t* buffer, uint8_t num, uint8_t val)
 {
 	uint8_t regNum;//shift reg number
 	uint8_t positionInReg;//Position if required led number inside current register
@@ -43,5 +127,10 @@ void lldLedSetVal(RegsChainDescriptor* interface, uint8_t num, uint8_t val)
 	regNum = pinNum >> 3;//replace division by shift. Get 8-bit shift register number
 	positionInReg = pinNum - (regNum << 3);
 
-	(interface->buffer_)[regNum] = ((interface->buffer_)[regNum] & ~(0x1 << positionInReg)) | (val ^ LED_ON) << positionInReg;
+	buffer[regNum] = (buffer[regNum] & ~(0x1 << positionInReg)) | (val ^ LED_ON) << positionInReg;
+}
+
+void lldLedSetVal(RegsChainDescriptor* interface, uint8_t num, uint8_t val)
+{
+	lldLedSetValInBuffer(interface, interface->buffer_, num, val);
 }
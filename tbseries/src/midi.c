@@ -15,6 +15,11 @@
 
 static uint8_t midiBuffer[MIDI_BUFFER_SIZE];
 
+//last NRPN parameter selected by midiSendNrpn()
+#define NRPN_NOT_SELECTED 0xFFFF
+static uint16_t nrpnSelectedParam = NRPN_NOT_SELECTED;
+static uint8_t nrpnSelectedChan;
+
 void initMidi()
 {
 	initUart0AsMidi();	
@@ -28,11 +33,45 @@ void midiSendProgramChange(uint8_t progNum, uint8_t chanNum)
 
 void midiSendControlChange(uint8_t ctrlNum, uint8_t val, uint8_t chanNum)
 {
+	//NRPN may be changed or RPN selected by user, midiSendNrpn() will select it again
+	if(ctrlNum == CC_NRPN_MSB || ctrlNum == CC_NRPN_LSB || ctrlNum == CC_RPN_MSB || ctrlNum == CC_RPN_LSB)
+		midiInvalidateNrpn();
+	
 	uart0PutChar(CC_STATUS | (0x0F & chanNum));
 	uart0PutChar(0x7F & ctrlNum);
 	uart0PutChar(0x7F & val);
 }
 
+void midiSendControlChange14Bit(uint8_t ctrlNum, uint16_t val, uint8_t chanNum, bool lsbOnly)
+{
+	if(!lsbOnly)
+		midiSendControlChange(ctrlNum, (uint8_t)(val >> 7), chanNum);
+	
+	midiSendControlChange(ctrlNum + CC_14BIT_LSB_OFFSET, (uint8_t)val, chanNum);
+}
+
+void midiSendNrpn(uint16_t paramNum, uint16_t val, uint8_t chanNum, bool lsbOnly)
+{
+	if(paramNum != nrpnSelectedParam || chanNum != nrpnSelectedChan)
+	{
+		midiSendControlChange(CC_NRPN_MSB, (uint8_t)(paramNum >> 7), chanNum);
+		midiSendControlChange(CC_NRPN_LSB, (uint8_t)paramNum, chanNum);
+		nrpnSelectedParam = paramNum;
+		nrpnSelectedChan = chanNum;
+		lsbOnly = false;//value MSB of new parameter is unknown
+	}
+	
+	if(!lsbOnly)
+		midiSendControlChange(CC_DATA_ENTRY_MSB, (uint8_t)(val >> 7), chanNum);
+	
+	midiSendControlChange(CC_DATA_ENTRY_LSB, (uint8_t)val, chanNum);
+}
+
+void midiInvalidateNrpn()
+{
+	nrpnSelectedParam = NRPN_NOT_SELECTED;
+}
+
 void midiSendNoteOn(uint8_t noteNum, uint8_t velocity, uint8_t chanNum)
 {
 	uart0PutChar(NOTE_ON_STATUS | (0x0F & chanNum));
@@ -49,35 +88,62 @@ void midiSendNoteOff(uint8_t noteNum, uint8_t velocity, uint8_t chanNum)
 
 void midiSendSysEx(uint16_t length, uint8_t* data)
 {
-	uint32_t i;
-	
 	uart0PutChar(SYSEX_STATUS);
-	
-	for (i = 0; i < length; ++i)
-	{
-		uart0PutChar(*(data + i));	
-	}
-	
-	uart0PutChar(0xF7);
+	midiSysExPutBlock(data, length);
+	midiSysExEnd();
 }
 
 void midiSendSysExManfId(uint32_t manfId, uint16_t length, uint8_t* data)
 {
-	uint32_t i;
-	
+	midiSysExBegin(manfId);
+	midiSysExPutBlock(data, length);
+	midiSysExEnd();
+}
+
+void midiSysExBegin(uint32_t manfId)
+{
 	uart0PutChar(SYSEX_STATUS);
 	
 	uart0PutChar((manfId >> 16) & 0x7F);
 	uart0PutChar((manfId >> 8) & 0x7F);
 	uart0PutChar(manfId & 0x7F);
-	
-	for (i = 0; i < length; ++i)
+}
+
+void midiSysExPut(uint8_t data)
+{
+	uart0PutChar(data);
+}
+
+void midiSysExPut14(uint16_t value)
+{
+	uart0PutChar((uint8_t)(value >> 7) & 0x7F);
+	uart0PutChar((uint8_t)value & 0x7F);
+}
+
+void midiSysExPutBlock(const uint8_t* data, uint16_t length)
+{
+	while(length--)
+		uart0PutChar(*data++);
+}
+
+void midiSysExPutString(const char* str)
+{
+	do
 	{
-		uart0PutChar(*(data + i));
-	}
+		uart0PutChar((uint8_t)*str);
+	}while(*str++ != '\0');
+}
+
+void midiSysExEnd()
+{
 	uart0PutChar(0xF7);
 }
 
+uint8_t midiGetTxQueueLength()
+{
+	return uart0GetTxQueueLength();
+}
+
 uint8_t getMessageLength(uint8_t messageType)
 {
 	switch(messageType)
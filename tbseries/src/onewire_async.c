@@ -0,0 +1,234 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	onewire_async.c
+ * 
+ * @brief	Interrupt driven 1-wire engine for the serial number IC bus.
+ *			Timing follows the same values as onewire.c (standard speed).
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "onewire_async.h"
+#include "onewire.h"
+#include "pinout.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
+
+//Timer1 normal mode, clock F_CPU/8, 1 tick per microsecond at 8MHz
+#define OW_ASYNC_PRESCALER_BITS (1 << CS11)
+#define OW_ASYNC_US(us) ((uint16_t)((us) * (F_CPU / 8 / 1000000UL)))
+
+#define OW_ASYNC_RESET_LOW_US		480
+#define OW_ASYNC_PRESENCE_US		61
+#define OW_ASYNC_RESET_END_US		(480 - OW_ASYNC_PRESENCE_US)
+#define OW_ASYNC_SLOT_LOW_US		1
+#define OW_ASYNC_SAMPLE_US			14
+#define OW_ASYNC_SLOT_US			60
+//Minimal distance between compare time and timer counter, which is surely caught after ISR returns
+#define OW_ASYNC_MIN_AHEAD_US		4
+
+//Other interrupts (e.g. Timer2 callbacks) delay compare ISR, AVR does not nest interrupts.
+//Presence pulse is guaranteed low only from 60 to 75us after reset release, and "0" slot low 
+//time must not exceed 120us. If these steps are late more than allowed, transaction fails
+#define OW_ASYNC_PRESENCE_LATE_MAX_US	(75 - OW_ASYNC_PRESENCE_US - 2)
+#define OW_ASYNC_SLOT_LATE_MAX_US		(120 - OW_ASYNC_SLOT_US - 10)
+
+#define OW_ASYNC_PIN_MASK (1 << SERIAL_NIMBER_IC_PIN)
+
+typedef enum OwAsyncState
+{
+	OW_ASYNC_IDLE = 0,
+	OW_ASYNC_RESET_RELEASE,
+	OW_ASYNC_PRESENCE,
+	OW_ASYNC_RESET_END,
+	OW_ASYNC_SLOT,
+	OW_ASYNC_SLOT_RELEASE
+}OwAsyncState;
+
+static volatile OwAsyncState state;
+static uint8_t writeBuffer[OW_ASYNC_WRITE_MAX];
+static uint8_t writeCount;
+static uint8_t* readBuffer;
+static uint8_t readCount;
+static uint8_t byteIndex;
+static uint8_t bitMask;
+static void (*doneCallback)(bool ok);
+
+static inline void busLow()
+{
+	SERIAL_NIMBER_IC_PORT &= ~OW_ASYNC_PIN_MASK;
+	SERIAL_NIMBER_IC_DDR |= OW_ASYNC_PIN_MASK;
+}
+
+static inline void busRelease()
+{
+	SERIAL_NIMBER_IC_DDR &= ~OW_ASYNC_PIN_MASK;
+#if OW_USE_INTERNAL_PULLUP
+	SERIAL_NIMBER_IC_PORT |= OW_ASYNC_PIN_MASK;
+#endif
+}
+
+//next step time is counted from previous step, so ISR latency does not accumulate
+static inline void scheduleNext(uint16_t us)
+{
+	uint16_t next = OCR1A + us;
+	
+	//Compare time is already passed or too close because of long interrupt latency. 
+	//Match would happen only after Timer1 overflow (65ms), so step is counted from now.
+	//Reset low, reset end and recovery have no upper limit. Timing critical steps are
+	//counted from the bus edge and check own latency, see OW_ASYNC_*_LATE_MAX_US
+	if((int16_t)(next - TCNT1) <= (int16_t)OW_ASYNC_US(OW_ASYNC_MIN_AHEAD_US))
+	{
+		if(us < OW_ASYNC_US(OW_ASYNC_MIN_AHEAD_US))
+			us = OW_ASYNC_US(OW_ASYNC_MIN_AHEAD_US);
+		next = TCNT1 + us;
+	}
+	OCR1A = next;
+}
+
+//Step is counted from bus edge made just now, so latency of this ISR does not shorten it
+static inline void scheduleFromNow(uint16_t us)
+{
+	OCR1A = TCNT1 + us;
+}
+
+static inline void nextBit()
+{
+	bitMask <<= 1;
+	if(bitMask == 0)
+	{
+		bitMask = 0x01;
+		++byteIndex;
+	}
+}
+
+static void finish(bool ok)
+{
+	TIMSK &= ~(1 << OCIE1A);
+	state = OW_ASYNC_IDLE;
+	if(doneCallback != NULL)
+		doneCallback(ok);
+}
+
+void initOwAsync()
+{
+	busRelease();
+	TCCR1A = 0;
+	TCCR1B = OW_ASYNC_PRESCALER_BITS;
+	state = OW_ASYNC_IDLE;
+}
+
+bool owAsyncStart(const uint8_t* writeData, uint8_t writeLen, uint8_t* readData, uint8_t readLen, void (*callback)(bool ok))
+{
+	if(writeLen > OW_ASYNC_WRITE_MAX || state != OW_ASYNC_IDLE)
+		return false;
+
+	memcpy(writeBuffer, writeData, writeLen);
+	writeCount = writeLen;
+	readBuffer = readData;
+	readCount = readLen;
+	byteIndex = 0;
+	bitMask = 0x01;
+	doneCallback = callback;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		state = OW_ASYNC_RESET_RELEASE;
+		busLow();
+		OCR1A = TCNT1 + OW_ASYNC_US(OW_ASYNC_RESET_LOW_US);
+		TIFR = (1 << OCF1A);
+		TIMSK |= (1 << OCIE1A);
+	}
+	return true;
+}
+
+bool owAsyncIsBusy()
+{
+	return state != OW_ASYNC_IDLE;
+}
+
+//One bit slot. "1" and read slots are finished here, "0" slot keeps line low until next step
+static void startSlot()
+{
+	bool reading = byteIndex >= writeCount;
+	uint8_t* byte = reading ? &readBuffer[byteIndex - writeCount] : &writeBuffer[byteIndex];
+	
+	busLow();
+	if(!reading && !(*byte & bitMask))
+	{
+		state = OW_ASYNC_SLOT_RELEASE;
+		scheduleFromNow(OW_ASYNC_US(OW_ASYNC_SLOT_US));
+		return;
+	}
+	
+	_delay_us(OW_ASYNC_SLOT_LOW_US);
+	busRelease();
+	if(reading)
+	{
+		_delay_us(OW_ASYNC_SAMPLE_US - OW_ASYNC_SLOT_LOW_US);
+		if(SERIAL_NIMBER_IC_IN & OW_ASYNC_PIN_MASK)
+			*byte |= bitMask;
+		else
+			*byte &= ~bitMask;
+	}
+	state = OW_ASYNC_SLOT;
+	scheduleNext(OW_ASYNC_US(OW_ASYNC_SLOT_US + OW_RECOVERY_TIME));
+	nextBit();
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+	uint16_t late = TCNT1 - OCR1A;//time since compare match
+	
+	switch(state)
+	{
+		case OW_ASYNC_RESET_RELEASE:
+			busRelease();
+			state = OW_ASYNC_PRESENCE;
+			scheduleFromNow(OW_ASYNC_US(OW_ASYNC_PRESENCE_US));
+			break;
+		
+		case OW_ASYNC_PRESENCE:
+			//presence pulse holds the line low, no device means failure.
+			//Late sample may miss the pulse, so it is a failure too
+			if(late > OW_ASYNC_US(OW_ASYNC_PRESENCE_LATE_MAX_US) || (SERIAL_NIMBER_IC_IN & OW_ASYNC_PIN_MASK))
+			{
+				finish(false);
+				break;
+			}
+			state = OW_ASYNC_RESET_END;
+			scheduleNext(OW_ASYNC_US(OW_ASYNC_RESET_END_US));
+			break;
+		
+		case OW_ASYNC_SLOT_RELEASE:
+			busRelease();
+			if(late > OW_ASYNC_US(OW_ASYNC_SLOT_LATE_MAX_US))
+			{
+				finish(false);//too long low, device may take it as reset
+				break;
+			}
+			state = OW_ASYNC_SLOT;
+			nextBit();
+			scheduleNext(OW_ASYNC_US(OW_RECOVERY_TIME));
+			break;
+		
+		case OW_ASYNC_RESET_END:
+		case OW_ASYNC_SLOT:
+			if(byteIndex >= writeCount + readCount)
+				finish(true);
+			else
+				startSlot();
+			break;
+		
+		default:
+			finish(false);
+			break;
+	}
+}
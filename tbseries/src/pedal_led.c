@@ -10,17 +10,36 @@
  
  #include "pedal_led.h"
  #include "lldled.h"
+ #include "timer.h"
+ #include "led_anim.h"
 
  #include <avr/pgmspace.h>
+ #include <string.h>
 
- static const uint8_t ledsNumTable[PEDAL_LEDS_NUM] PROGMEM =
-		{    45,46,47, 42,43,44, 39,40,41, 36,37,38, 33,34,35, 30,31,32, 27,28,29, 24,25,26
-			,0,1,2,    3,4,5,    6,7,8,    9,10,11,  12,13,14, 15,16,17, 18,19,20, 21,22,23};
+ //Red, green and blue pins of each LED
+#define PEDAL_LED_PINS_LIST(X) \
+		X(45,46,47) X(42,43,44) X(39,40,41) X(36,37,38) X(33,34,35) X(30,31,32) X(27,28,29) X(24,25,26) \
+		X(0,1,2)    X(3,4,5)    X(6,7,8)    X(9,10,11)  X(12,13,14) X(15,16,17) X(18,19,20) X(21,22,23)
+
+#define PEDAL_LED_PIN_NUMS(red, green, blue) red, green, blue,
+ static const uint8_t ledsNumTable[PEDAL_LEDS_NUM] PROGMEM = {PEDAL_LED_PINS_LIST(PEDAL_LED_PIN_NUMS)};
+
+//Buffer byte and bit mask of each LED color, red is first. LED may be split between two registers
+typedef struct PedalLedBits
+{
+	uint8_t reg_[3];
+	uint8_t mask_[3];
+}PedalLedBits;
+
+#define PEDAL_LED_PIN_BITS(red, green, blue) \
+		{{LLDLED_REG(red), LLDLED_REG(green), LLDLED_REG(blue)}, {LLDLED_MASK(red), LLDLED_MASK(green), LLDLED_MASK(blue)}},
+static const PedalLedBits ledBitsTable[PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM] PROGMEM = {PEDAL_LED_PINS_LIST(PEDAL_LED_PIN_BITS)};
 
 /*
  * prepare led interface
  */
 static uint8_t ledBuffer[PEDAL_REGS_NUM];
+static uint8_t colorPlanes[3][PEDAL_REGS_NUM];//pins of all red, green and blue LEDs in each register, for ledSetPedalColorAll()
 
 static const ioPort clkPort = {&PEDAL_LED_CLK_PORT, PEDAL_LED_CLK_PIN};
 static const ioPort dataPort = {&PEDAL_LED_DATA_PORT, PEDAL_LED_DATA_PIN};
@@ -28,9 +47,44 @@ static const ioPort oePort = {&PEDAL_LED_OE_PORT, PEDAL_LED_OE_PIN};
 
 //TODO place it to PROGMEM
 static RegsChainDescriptor chainDescriptors;
+static uint8_t sentBuffer[PEDAL_REGS_NUM];
+
+//Auto flush from timer interrupt
+static volatile bool autoFlush;
+static volatile uint8_t updateDepth;
+static bool autoFlushRegistered;
+static uint8_t autoFlushTimer;
+
+//Animation buffers
+static LedAnimState animStates[PEDAL_LEDS_NUM];
+static uint8_t animPlanes[LED_ANIM_PLANES_SIZE(PEDAL_REGS_NUM)];
+static uint8_t animMask[PEDAL_REGS_NUM];
+static uint8_t animFrame[PEDAL_REGS_NUM];
+static uint8_t animCommitted[PEDAL_REGS_NUM];
+static LedAnimChain animChain;
+static volatile bool commitHeld;//buffer is sent during update, snapshot is taken when update ends
+
+//R, G, B components of PedalLedColor, bit 0 is red
+static const uint8_t colorComponents[] PROGMEM = {0x00, 0x01, 0x02, 0x04, 0x03, 0x05, 0x06, 0x07};
+
+//Bar graph. Pattern N is whole chain buffer with N lit segments
+static uint8_t barPatterns[PEDAL_BAR_SEGMENTS + 1][PEDAL_REGS_NUM];
+static PedalLedColor barZones[PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM_IN_LINE] = 
+		{PEDAL_COLOR_G, PEDAL_COLOR_G, PEDAL_COLOR_G, PEDAL_COLOR_G, PEDAL_COLOR_G, PEDAL_COLOR_RG, PEDAL_COLOR_RG, PEDAL_COLOR_R};
+static bool barPatternsValid;
+static uint8_t barCount = 0xFF;
+static PedalNumber barPedal;
+
+#ifndef PEDAL_LED_CHAIN_SPI
+LLDLED_DEFINE_BITBANG_SEND(chainSend, PEDAL_LED_CLK, PEDAL_LED_DATA)
+#endif
 
 void initPedalLed()
 {
+	PedalLedBits bits;
+	uint8_t i;
+	uint8_t j;
+	
 	initOutput(&clkPort, 0);
 	initOutput(&dataPort, 0);
 	initOutput(&oePort, 0);
@@ -41,85 +95,264 @@ void initPedalLed()
 	chainDescriptors.data_ = &dataPort;
 	chainDescriptors.oe_ = &oePort;
 	chainDescriptors.buffer_ = ledBuffer;
+	chainDescriptors.sentBuffer_ = sentBuffer;
+	chainDescriptors.sentValid_ = false;
 	chainDescriptors.ledNumTable_ = (uint8_t*)&ledsNumTable;//data in PROGMEM!!
+#ifdef PEDAL_LED_CHAIN_SPI
+	chainDescriptors.transport_ = LLDLED_SPI;
+	lldLedInitSpi();
+#else
+	chainDescriptors.transport_ = LLDLED_BITBANG;
+	chainDescriptors.send_ = chainSend;
+#endif
+	
+	for(i = 0; i < PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM; ++i)
+	{
+		memcpy_P(&bits, &ledBitsTable[i], sizeof(bits));
+		for(j = 0; j < 3; ++j)
+			colorPlanes[j][bits.reg_[j]] |= bits.mask_[j];
+	}
+}
+
+//Animated chain is sent by timer, only snapshot of buffer is taken. Half-updated buffer is never committed
+static void sendChain()
+{
+	if(!chainDescriptors.animated_)
+	{
+		lldLedSend(&chainDescriptors);//nothing is sent if buffer is not changed
+		return;
+	}
+	
+	if(updateDepth == 0)
+		ledAnimCommit(&animChain);
+	else
+		commitHeld = true;
+}
+
+static void autoFlushCallback()
+{
+	if(!autoFlush || ++autoFlushTimer < PEDAL_LED_AUTO_FLUSH_PERIOD_MS)
+		return;
+	
+	autoFlushTimer = 0;
+	if(updateDepth == 0)
+		sendChain();
+}
+
+void ledPedalSetAutoFlush(bool enable)
+{
+	if(enable && !autoFlushRegistered)
+		autoFlushRegistered = timerRegisterMsCallback(autoFlushCallback);
+	
+	autoFlush = enable && autoFlushRegistered;
+}
+
+void ledPedalBeginUpdate()
+{
+	++updateDepth;
+}
+
+void ledPedalEndUpdate()
+{
+	if(updateDepth > 0 && --updateDepth == 0 && commitHeld)
+	{
+		commitHeld = false;
+		if(chainDescriptors.animated_)
+			ledAnimCommit(&animChain);
+	}
 }
 
 void ledPedalSend()
 {
-	lldLedSend(&chainDescriptors);
+	if(autoFlush)
+		return;//buffer will be sent by timer
+	
+	sendChain();
 }
 
-void ledSetPedalColor(uint8_t ledNum, PedalLedColor color, bool send)
+static void setColorInBuffer(uint8_t* buffer, uint8_t ledNum, PedalLedColor color)
 {
-	uint8_t phyLedNum = ledNum*3;
-	switch(color)
+	PedalLedBits bits;
+	uint8_t components;
+	uint8_t reg;
+	uint8_t mask = 0;
+	uint8_t onMask = 0;
+	uint8_t i;
+	
+	if(color > PEDAL_COLOR_RGB)
+		return;
+	
+	memcpy_P(&bits, &ledBitsTable[ledNum], sizeof(bits));
+	components = pgm_read_byte(&colorComponents[color]);
+	
+	//colors in the same register are written at once
+	reg = bits.reg_[0];
+	for(i = 0; i < 3; ++i, components >>= 1)
 	{
-		case PEDAL_COLOR_NO :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_OFF);
-			break;
-
-        case PEDAL_COLOR_R :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_OFF);
-			break;
-        
-        case PEDAL_COLOR_G :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_OFF);
-			break;
-        
-        case PEDAL_COLOR_B :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_ON);
-			break;
-        
-        case PEDAL_COLOR_RG :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_OFF);
-			break;
-        
-        case PEDAL_COLOR_RB :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_ON);
-			break;
-
-        case PEDAL_COLOR_GB :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_OFF);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_ON);
-			break;
-
-        case PEDAL_COLOR_RGB :
-			lldLedSetVal(&chainDescriptors, phyLedNum, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 1, LED_ON);
-			lldLedSetVal(&chainDescriptors, phyLedNum + 2, LED_ON);
-			break;
-				
-		
-		default : break;
+		if(bits.reg_[i] != reg)
+		{
+			LLDLED_WRITE_BITS(buffer, reg, mask, onMask);
+			reg = bits.reg_[i];
+			mask = 0;
+			onMask = 0;
+		}
+		mask |= bits.mask_[i];
+		if(components & 0x01)
+			onMask |= bits.mask_[i];
 	}
+	LLDLED_WRITE_BITS(buffer, reg, mask, onMask);
+}
+
+void ledSetPedalColor(uint8_t ledNum, PedalLedColor color, bool send)
+{
+	setColorInBuffer(ledBuffer, ledNum, color);
+	
 	if(send)
-	ledPedalSend();
+		ledPedalSend();
 }
 
 void ledSetPedalColorAll(PedalLedColor color, bool send)
 {
-    unsigned char i;
-    for (i = 0; i < PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM; ++i)
-		ledSetPedalColor(i, color, false);
+	uint8_t components;
+	uint8_t mask;
+	uint8_t onMask;
+	uint8_t i;
+	
+	if(color > PEDAL_COLOR_RGB)
+		return;
+	
+	components = pgm_read_byte(&colorComponents[color]);
+	for (i = 0; i < PEDAL_REGS_NUM; ++i)
+	{
+		mask = colorPlanes[0][i] | colorPlanes[1][i] | colorPlanes[2][i];
+		onMask = ((components & 0x01) ? colorPlanes[0][i] : 0) 
+			| ((components & 0x02) ? colorPlanes[1][i] : 0)
+			| ((components & 0x04) ? colorPlanes[2][i] : 0);
+		LLDLED_WRITE_BITS(ledBuffer, i, mask, onMask);
+	}
     
-    if(send)
+	if(send)
 		ledPedalSend();
 }
 
+static void setAnimation(uint8_t ledNum, PedalLedColor color, LedAnimMode mode, uint8_t level, uint16_t periodMs)
+{
+	uint8_t phyLedNum = ledNum*3;
+	uint8_t components;
+	uint8_t i;
+	
+	if(color > PEDAL_COLOR_RGB)
+		return;
+	
+	if(!chainDescriptors.animated_)
+	{
+		animChain.chain_ = &chainDescriptors;
+		animChain.leds_ = animStates;
+		animChain.planes_ = animPlanes;
+		animChain.mask_ = animMask;
+		animChain.frame_ = animFrame;
+		animChain.committed_ = animCommitted;
+		if(!ledAnimAttach(&animChain))
+			return;
+	}
+	
+	//color component which is not used is held off
+	components = pgm_read_byte(&colorComponents[color]);
+	for(i = 0; i < 3; ++i, components >>= 1)
+	{
+		if(components & 0x01)
+			ledAnimSet(&animChain, phyLedNum + i, mode, level, periodMs);
+		else
+			ledAnimSet(&animChain, phyLedNum + i, LED_ANIM_STEADY, 0, periodMs);
+	}
+}
+
+void ledSetPedalBlink(uint8_t ledNum, PedalLedColor color, uint16_t periodMs)
+{
+	setAnimation(ledNum, color, LED_ANIM_BLINK, LED_ANIM_MAX_LEVEL, periodMs);
+}
+
+void ledSetPedalPulse(uint8_t ledNum, PedalLedColor color, uint16_t periodMs)
+{
+	setAnimation(ledNum, color, LED_ANIM_PULSE, LED_ANIM_MAX_LEVEL, periodMs);
+}
 
+void ledSetPedalBrightness(uint8_t ledNum, PedalLedColor color, uint8_t level)
+{
+	setAnimation(ledNum, color, LED_ANIM_STEADY, level, 0);
+}
 
- 
-  
+void ledStopPedalAnimation(uint8_t ledNum)
+{
+	uint8_t i;
+	
+	if(!chainDescriptors.animated_)
+		return;
+	
+	for(i = 0; i < 3; ++i)
+		ledAnimSet(&animChain, ledNum*3 + i, LED_ANIM_NONE, 0, 0);
+}
+
+//Segment 2N+1 lights left LED of row N from the bottom, segment 2N+2 lights both LEDs of the row
+static void buildBarPatterns()
+{
+	uint8_t i;
+	uint8_t row;
+	
+	for(i = 0; i < PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM; ++i)
+		setColorInBuffer(barPatterns[0], i, PEDAL_COLOR_NO);
+	
+	for(i = 1; i <= PEDAL_BAR_SEGMENTS; ++i)
+	{
+		row = (i - 1) >> 1;
+		memcpy(barPatterns[i], barPatterns[i - 1], PEDAL_REGS_NUM);
+		if(i & 0x01)
+			setColorInBuffer(barPatterns[i], PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM_IN_LINE - 1 - row, barZones[row]);
+		else
+			setColorInBuffer(barPatterns[i], PEDAL_TRICOLOR_VIRTUAL_LEDS_NUM - 1 - row, barZones[row]);
+	}
+	
+	barPatternsValid = true;
+	barCount = 0xFF;
+}
+
+void ledPedalBarSetZones(const PedalLedColor* rowColors)
+{
+	memcpy(barZones, rowColors, sizeof(barZones));
+	barPatternsValid = false;
+}
+
+void ledPedalBarShow(uint8_t value)
+{
+	uint8_t count = ((uint16_t)value * (PEDAL_BAR_SEGMENTS + 1)) >> 7;
+	
+	if(!barPatternsValid)
+		buildBarPatterns();
+	
+	if(count == barCount)
+		return;//nothing is shifted out while segments count is not changed
+	
+	barCount = count;
+	ledPedalBeginUpdate();
+	memcpy(ledBuffer, barPatterns[count], PEDAL_REGS_NUM);
+	ledPedalEndUpdate();
+	ledPedalSend();
+}
+
+static void barDisplayCallback(PedalNumber pedalNumber, uint8_t position)
+{
+	if(pedalNumber == barPedal)
+		ledPedalBarShow(position);
+}
+
+void ledPedalBarAttach(PedalNumber pedalNumber)
+{
+	barPedal = pedalNumber;
+	ledPedalBarShow(expGetPedalPosition(pedalNumber));
+	expRegisterPedalDisplayCallback(barDisplayCallback);
+}
+
+void ledPedalBarDetach()
+{
+	expRegisterPedalDisplayCallback(NULL);
+}
@@ -3,7 +3,8 @@
  * @file	timer.c
  * 
  * @brief	Provide timer ticks since last reset.
- *			one tick is approx 32.75ms				
+ *			one tick is approx 32.75ms, Timer0 is used.
+ *			Millisecond counter uses Timer2 in CTC mode
  *
  * Software is provided "as is" without express or implied warranty.
  * BJ Devices 2016
@@ -13,8 +14,17 @@
 #include <stdint.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 
 static volatile uint32_t ticks;
+static volatile uint32_t millis;
+static void (*msCallbacks[TIMER_MS_CALLBACKS_MAX])(void);
+static volatile uint8_t msCallbacksNum;
+
+//Timer2 CTC mode, clock F_CPU/64, compare match every 1ms
+#define TIMER2_MS_PRESCALER_BITS ((1 << CS21) | (1 << CS20))
+#define TIMER2_MS_TOP (F_CPU / 64 / 1000 - 1)
+#define TIMER2_US_PER_COUNT (64 * 1000000UL / F_CPU)
 
 void initTimer()
 {
@@ -23,6 +33,12 @@ void initTimer()
     OCR0 = 0x00;
 	TIMSK |= (1<<0);
     ticks = 0;
+	
+	TCCR2 = (1 << WGM21) | TIMER2_MS_PRESCALER_BITS;
+	TCNT2 = 0x00;
+	OCR2 = TIMER2_MS_TOP;
+	TIMSK |= (1 << OCIE2);
+	millis = 0;
 }
 
 uint32_t getTicks()
@@ -36,7 +52,54 @@ uint32_t getTicks()
     return tmp;
 }
 
+uint32_t getMillis()
+{
+	uint32_t tmp;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		tmp = millis;
+	}
+	return tmp;
+}
+
+uint32_t getMicros()
+{
+	uint32_t ms;
+	uint8_t count;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ms = millis;
+		count = TCNT2;
+		//compare match is occurred, but interrupt is not handled yet
+		if((TIFR & (1 << OCF2)) && count < (TIMER2_MS_TOP >> 1))
+			++ms;
+	}
+	return ms * 1000 + count * TIMER2_US_PER_COUNT;
+}
+
+bool timerRegisterMsCallback(void (*callback)(void))
+{
+	if(msCallbacksNum == TIMER_MS_CALLBACKS_MAX)
+		return false;
+	
+	//slot is filled before counter is incremented, so interrupt never sees empty slot
+	msCallbacks[msCallbacksNum] = callback;
+	++msCallbacksNum;
+	return true;
+}
+
 ISR(TIMER0_OVF_vect)
 {
 	 ++ticks;
+}
+
+ISR(TIMER2_COMP_vect)
+{
+	uint8_t i;
+	
+	++millis;
+	for(i = 0; i < msCallbacksNum; ++i)
+		(*msCallbacks[i])();
 }
\ No newline at end of file
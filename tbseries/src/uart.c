@@ -12,6 +12,7 @@
 #include "log.h"
 
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <avr/pgmspace.h>
 
 static uint8_t rxBuffer0[RX_BUFFER_SIZE0];
@@ -31,6 +32,26 @@ static uint16_t rxCounter0;
 // This flag is set on USART0 Receiver buffer overflow
 static bool rxBufferOverflow0;
 
+#if TX_BUFFER_SIZE0 > 256
+#	error "TX_BUFFER_SIZE0 is too big"
+#endif
+
+static uint8_t txBuffer0[TX_BUFFER_SIZE0];
+static uint8_t txWrIndex0;
+static uint8_t txRdIndex0;
+static volatile uint8_t txCounter0;
+
+// Move one byte from transmitter buffer to USART0, buffer must not be empty
+static inline void txSendNext0()
+{
+	UDR0 = txBuffer0[txRdIndex0++];
+	#if TX_BUFFER_SIZE0 != 256
+	if (txRdIndex0 == TX_BUFFER_SIZE0)
+		txRdIndex0 = 0;
+	#endif
+	--txCounter0;
+}
+
 // USART0 Receiver interrupt service routine
 ISR(USART0_RX_vect)
 {
@@ -59,6 +80,19 @@ ISR(USART0_RX_vect)
 	}
 }
 
+// USART0 Data register empty interrupt service routine
+ISR(USART0_UDRE_vect)
+{
+	if (txCounter0 == 0)
+	{
+		// nothing to send, disable interrupt until next byte
+		UCSR0B &= ~(1 << UDRIE0);
+		return;
+	}
+	
+	txSendNext0();
+}
+
 void initUart0AsMidi()
 {
 	// Communication Parameters: 8 Data, 1 Stop, No Parity
@@ -75,8 +109,43 @@ void initUart0AsMidi()
 
 void uart0PutChar(uint8_t data)
 {
-	while ((UCSR0A & DATA_REGISTER_EMPTY) == 0);
-	UDR0 = data;
+	// called from interrupt or with interrupts disabled, buffer would never be released.
+	// Queued bytes and this one are sent by polling to keep order
+	if (!(SREG & (1 << SREG_I)))
+	{
+		while (txCounter0)
+		{
+			while ((UCSR0A & DATA_REGISTER_EMPTY) == 0);
+			txSendNext0();
+		}
+		while ((UCSR0A & DATA_REGISTER_EMPTY) == 0);
+		UDR0 = data;
+		return;
+	}
+	
+	// wait for free space, buffer is released by interrupt
+	#if TX_BUFFER_SIZE0 == 256
+	while (txCounter0 == 255);
+	#else
+	while (txCounter0 == TX_BUFFER_SIZE0);
+	#endif
+	
+	txBuffer0[txWrIndex0++] = data;
+	#if TX_BUFFER_SIZE0 != 256
+	if (txWrIndex0 == TX_BUFFER_SIZE0)
+		txWrIndex0 = 0;
+	#endif
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		++txCounter0;
+		UCSR0B |= (1 << UDRIE0);
+	}
+}
+
+uint8_t uart0GetTxQueueLength()
+{
+	return txCounter0;
 }
 
 uint8_t uart0GetChar()
@@ -10,29 +10,143 @@
  * BJ Devices 2016
  */
 
+#include "unique_id.h"
 #include "pinout.h"
 #include "onewire.h"
-#include "crc8.h"
+#include "onewire_async.h"
+#include "checksum.h"
 
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <avr/eeprom.h>
+
+//Copy of ID stored in EEPROM after first successful read
+typedef struct UniqIdBlock
+{
+	uint8_t id_[UNIQ_ID_SIZE];
+	uint16_t crc_;
+}UniqIdBlock;
+
+static UniqIdBlock eeUniqId EEMEM;
+
+static uint8_t cachedId[UNIQ_ID_SIZE];
+static bool cachedIdValid;
+static UniqIdStatus status;
+
+//background read
+static uint8_t readBuffer[UNIQ_ID_SIZE];
+static volatile bool readDone;
+static volatile bool readPresence;
+static uint8_t readAttempts;
+
+static bool idCrcMatched(const uint8_t* buffer)
+{
+	return buffer[UNIQ_ID_SIZE-1] == crc8Maxim(buffer, UNIQ_ID_SIZE-1);
+}
+
+static void updateCache(const uint8_t* buffer)
+{
+	UniqIdBlock block;
+	
+	if(cachedIdValid && memcmp(cachedId, buffer, UNIQ_ID_SIZE) == 0)
+	{
+		status = UNIQ_ID_VERIFIED;
+		return;
+	}
+	
+	memcpy(cachedId, buffer, UNIQ_ID_SIZE);
+	cachedIdValid = true;
+	status = UNIQ_ID_UPDATED;
+	
+	memcpy(block.id_, buffer, UNIQ_ID_SIZE);
+	block.crc_ = crc16Ccitt(block.id_, UNIQ_ID_SIZE);
+	eeprom_update_block(&block, &eeUniqId, sizeof(block));
+}
+
+static void readCallback(bool ok)
+{
+	readPresence = ok;
+	readDone = true;
+}
 
 void initUniqId()
 {
-	ow_set_bus(&SERIAL_NIMBER_IC_IN,&SERIAL_NIMBER_IC_PORT,&SERIAL_NIMBER_IC_DDR,SERIAL_NIMBER_IC_PIN);
+	UniqIdBlock block;
+	
+	initOwAsync();
+	
+	eeprom_read_block(&block, &eeUniqId, sizeof(block));
+	cachedIdValid = block.crc_ == crc16Ccitt(block.id_, UNIQ_ID_SIZE) && idCrcMatched(block.id_);
+	if(cachedIdValid)
+	{
+		memcpy(cachedId, block.id_, UNIQ_ID_SIZE);
+		status = UNIQ_ID_CACHED;
+	}
+	else
+	{
+		status = UNIQ_ID_UNKNOWN;
+		uniqIdStartVerify();
+	}
 }
 
 bool uniqIdGet(uint8_t* buffer)
 {
+	if(owAsyncIsBusy())
+		return false;
+	
+	//ow_set_bus makes bus reset
+	ow_set_bus(&SERIAL_NIMBER_IC_IN,&SERIAL_NIMBER_IC_PORT,&SERIAL_NIMBER_IC_DDR,SERIAL_NIMBER_IC_PIN);
 	ow_byte_wr(OWI_READ_ROM);
 
 	uint8_t i;
-	for (i = 0; i < 8; ++i)
+	for (i = 0; i < UNIQ_ID_SIZE; ++i)
 		buffer[i] = ow_byte_rd();
 
-	if(buffer[OW_ROMCODE_SIZE-1] == crc8(buffer, OW_ROMCODE_SIZE-1))
-		return true;
-	else
+	if(!idCrcMatched(buffer))
 		return false;
+	
+	updateCache(buffer);
+	return true;
+}
+
+bool uniqIdGetCached(uint8_t* buffer)
+{
+	memcpy(buffer, cachedId, UNIQ_ID_SIZE);
+	return cachedIdValid;
+}
+
+bool uniqIdStartVerify()
+{
+	const uint8_t command = OWI_READ_ROM;
+	
+	readDone = false;
+	readAttempts = UNIQ_ID_READ_ATTEMPTS - 1;
+	return owAsyncStart(&command, 1, readBuffer, UNIQ_ID_SIZE, readCallback);
+}
+
+void uniqIdProcess()
+{
+	const uint8_t command = OWI_READ_ROM;
+	
+	if(!readDone)
+		return;
+	
+	readDone = false;
+	if(readPresence && idCrcMatched(readBuffer))
+	{
+		updateCache(readBuffer);
+		return;
+	}
+	
+	if(readAttempts && owAsyncStart(&command, 1, readBuffer, UNIQ_ID_SIZE, readCallback))
+		--readAttempts;
+	else
+		status = UNIQ_ID_NOT_AVAILABLE;
+}
+
+UniqIdStatus uniqIdGetStatus()
+{
+	return status;
 }
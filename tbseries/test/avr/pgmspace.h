@@ -0,0 +1,18 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	pgmspace.h
+ * 
+ * @brief	Host stub of avr-libc pgmspace.h for PC tests. Flash data is ordinary RAM on PC
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+
+#ifndef pgmspace_h_
+#define pgmspace_h_
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+#endif /* pgmspace_h_ */
@@ -0,0 +1,172 @@
+/*
+ * BJ Devices Travel Box series midi controller library
+ * @file	checksum_test.c
+ *
+ * @brief	PC test and benchmark for checksum.c kernels. Checks "123456789" values and compares
+ *			CRC kernels with bit-serial reference on random data split into random blocks.
+ *			Build and run from library root for both CRC-8 variants:
+ *			gcc -std=gnu99 -O2 -Itbseries/test -Itbseries/include tbseries/test/checksum_test.c tbseries/src/checksum.c -o checksum_test && ./checksum_test
+ *			gcc -std=gnu99 -O2 -DCHECKSUM_CRC8_NIBBLE_TABLE -Itbseries/test -Itbseries/include tbseries/test/checksum_test.c tbseries/src/checksum.c -o checksum_test && ./checksum_test
+ *			Benchmark shows PC speed only, relative gain on ATmega64 differs
+ *
+ * Software is provided "as is" without express or implied warranty.
+ * BJ Devices 2016
+ */
+
+#include "checksum.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TEST_RANDOM_RUNS	100000
+#define TEST_BUFFER_SIZE	300
+#define BENCH_BUFFER_SIZE	4096
+#define BENCH_RUNS			20000
+
+static const char checkString[] = "123456789";
+
+static int failures;
+
+//Reference implementations, one bit per step
+static uint8_t crc8MaximBitwise(uint8_t crc, const uint8_t* data, uint16_t size)
+{
+	uint8_t i;
+
+	while(size--)
+	{
+		crc ^= *data++;
+		for(i = 0; i < 8; ++i)
+			crc = (crc & 0x01) ? (crc >> 1) ^ 0x8C : crc >> 1;
+	}
+	return crc;
+}
+
+static uint16_t crc16CcittBitwise(uint16_t crc, const uint8_t* data, uint16_t size)
+{
+	uint8_t i;
+
+	while(size--)
+	{
+		crc ^= (uint16_t)*data++ << 8;
+		for(i = 0; i < 8; ++i)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+static void check(bool ok, const char* name)
+{
+	if(!ok)
+	{
+		printf("FAIL: %s\n", name);
+		++failures;
+	}
+}
+
+static void testCheckValues()
+{
+	check(crc8Maxim(checkString, 9) == 0xA1, "CRC-8/Maxim check value");
+	check(crc16Ccitt(checkString, 9) == 0x29B1, "CRC-16/CCITT-FALSE check value");
+	check(crc8MaximBitwise(CRC8_MAXIM_INIT, (const uint8_t*)checkString, 9) == 0xA1, "CRC-8/Maxim reference check value");
+	check(crc16CcittBitwise(CRC16_CCITT_INIT, (const uint8_t*)checkString, 9) == 0x29B1, "CRC-16/CCITT-FALSE reference check value");
+	check(xorChecksumUpdate(XOR_CHECKSUM_INIT, checkString, 9) == 0x31, "XOR checksum check value");
+	check(crc8Maxim(checkString, 0) == CRC8_MAXIM_INIT, "CRC-8/Maxim empty block");
+	check(crc16Ccitt(checkString, 0) == CRC16_CCITT_INIT, "CRC-16/CCITT-FALSE empty block");
+}
+
+//Random data is processed in two blocks to check incremental calls too
+static void testRandomData()
+{
+	uint8_t buf[TEST_BUFFER_SIZE];
+	uint16_t size;
+	uint16_t split;
+	uint16_t i;
+	uint8_t sum;
+	long run;
+
+	srand(1);
+	for(run = 0; run < TEST_RANDOM_RUNS && !failures; ++run)
+	{
+		size = rand() % TEST_BUFFER_SIZE;
+		split = size ? rand() % size : 0;
+		sum = XOR_CHECKSUM_INIT;
+		for(i = 0; i < size; ++i)
+		{
+			buf[i] = rand();
+			sum ^= buf[i];
+		}
+
+		check(crc8MaximUpdate(crc8Maxim(buf, split), buf + split, size - split)
+			== crc8MaximBitwise(CRC8_MAXIM_INIT, buf, size), "CRC-8/Maxim random data");
+		check(crc16CcittUpdate(crc16Ccitt(buf, split), buf + split, size - split)
+			== crc16CcittBitwise(CRC16_CCITT_INIT, buf, size), "CRC-16/CCITT-FALSE random data");
+		check(xorChecksumUpdate(xorChecksumUpdate(XOR_CHECKSUM_INIT, buf, split), buf + split, size - split)
+			== sum, "XOR checksum random data");
+	}
+}
+
+static double nsPerByte(clock_t start)
+{
+	return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ((double)BENCH_BUFFER_SIZE * BENCH_RUNS);
+}
+
+//Result is accumulated and printed, so compiler does not remove the loops
+static void benchmark()
+{
+	static uint8_t buf[BENCH_BUFFER_SIZE];
+	unsigned acc = 0;
+	clock_t start;
+	long run;
+	uint16_t i;
+
+	for(i = 0; i < BENCH_BUFFER_SIZE; ++i)
+		buf[i] = rand();
+
+#ifdef CHECKSUM_CRC8_NIBBLE_TABLE
+	printf("CRC-8/Maxim variant: nibble tables\n");
+#else
+	printf("CRC-8/Maxim variant: 256-byte table\n");
+#endif
+
+	start = clock();
+	for(run = 0; run < BENCH_RUNS; ++run)
+		acc += crc8MaximUpdate(run, buf, BENCH_BUFFER_SIZE);
+	printf("crc8MaximUpdate      %6.2f ns/byte\n", nsPerByte(start));
+
+	start = clock();
+	for(run = 0; run < BENCH_RUNS; ++run)
+		acc += crc8MaximBitwise(run, buf, BENCH_BUFFER_SIZE);
+	printf("CRC-8 bit-serial     %6.2f ns/byte\n", nsPerByte(start));
+
+	start = clock();
+	for(run = 0; run < BENCH_RUNS; ++run)
+		acc += crc16CcittUpdate(run, buf, BENCH_BUFFER_SIZE);
+	printf("crc16CcittUpdate     %6.2f ns/byte\n", nsPerByte(start));
+
+	start = clock();
+	for(run = 0; run < BENCH_RUNS; ++run)
+		acc += crc16CcittBitwise(run, buf, BENCH_BUFFER_SIZE);
+	printf("CRC-16 bit-serial    %6.2f ns/byte\n", nsPerByte(start));
+
+	start = clock();
+	for(run = 0; run < BENCH_RUNS; ++run)
+		acc += xorChecksumUpdate(run, buf, BENCH_BUFFER_SIZE);
+	printf("xorChecksumUpdate    %6.2f ns/byte\n", nsPerByte(start));
+
+	printf("(%u)\n", acc);
+}
+
+int main()
+{
+	testCheckValues();
+	testRandomData();
+	if(failures)
+		return 1;
+
+	printf("All checks passed\n");
+	benchmark();
+	return 0;
+}
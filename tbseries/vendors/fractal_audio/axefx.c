@@ -10,6 +10,7 @@
 
 #include "axefx.h"
 #include "midi.h"
+#include "checksum.h"
 
 #include <avr/pgmspace.h>
 #include <string.h>
@@ -23,36 +24,53 @@ static const uint8_t functionPayloadOffsetBytes PROGMEM = 6;
 //other constants
 static const uint8_t effectBlockSize PROGMEM = 5;
 
-static uint8_t getChecksum(uint8_t* array, uint16_t size)
+//XOR of SysEx status and manufacturer ID, constant part of every message checksum
+#define AXEFX_CHECKSUM_HEADER (SYSEX_STATUS ^ (uint8_t)FRACTAL_AUDIO_MANF_ID \
+	^ (uint8_t)((uint32_t)FRACTAL_AUDIO_MANF_ID >> 8) ^ (uint8_t)((uint32_t)FRACTAL_AUDIO_MANF_ID >> 16))
+
+void axefxSendFunctionRequest(AxeFxModelId modelId, AxeFxFunctionId functionId, uint8_t* payload, uint16_t payloadLength)
 {
-	uint16_t i;
-	uint8_t checksum = 0;
+	const uint8_t header[2] = {(uint8_t)modelId, (uint8_t)functionId};
+	uint8_t checksum = xorChecksumUpdate(AXEFX_CHECKSUM_HEADER, header, sizeof(header));
 	
-	checksum ^= SYSEX_STATUS;
-	checksum ^= (uint8_t)FRACTAL_AUDIO_MANF_ID;
-	checksum ^= (uint8_t)((uint32_t)FRACTAL_AUDIO_MANF_ID >> 8);
-	checksum ^= (uint8_t)((uint32_t)FRACTAL_AUDIO_MANF_ID >> 16);
-	
-	for (i = 0; i < size; ++i)
-		checksum ^= *(array + i);
+	midiSysExBegin(FRACTAL_AUDIO_MANF_ID);
+	midiSysExPutBlock(header, sizeof(header));
+	if(payload != NULL && payloadLength != 0)
+	{
+		midiSysExPutBlock(payload, payloadLength);
+		checksum = xorChecksumUpdate(checksum, payload, payloadLength);
+	}
+	midiSysExPut(checksum & 0x7f);//last byte is a checksum
+	midiSysExEnd();
+}
+
+void axefxSendSetParameter(AxeFxModelId modelId, uint16_t effectId, uint16_t paramId, uint16_t value)
+{
+	uint8_t payload[8];
 	
-	checksum &= 0x7f;
+	//all values are sent as 7-bit chunks, least significant first
+	payload[0] = effectId & 0x7F;
+	payload[1] = (effectId >> 7) & 0x7F;
+	payload[2] = paramId & 0x7F;
+	payload[3] = (paramId >> 7) & 0x7F;
+	payload[4] = value & 0x7F;
+	payload[5] = (value >> 7) & 0x7F;
+	payload[6] = (value >> 14) & 0x03;
+	payload[7] = 0x01;//set, 0 is query
 	
-	return checksum; 
+	axefxSendFunctionRequest(modelId, AXEFX_GET_SET_PARAMETER, payload, sizeof(payload));
 }
 
-void axefxSendFunctionRequest(AxeFxModelId modelId, AxeFxFunctionId functionId, uint8_t* payload, uint16_t payloadLength)
+static AxeFxModelId mappingModelId = AXEFX_2_MODEL;
+
+void axefxSetMappingModel(AxeFxModelId modelId)
 {
-	uint16_t messageSize = 3 + payloadLength;//total length is payloadLength + 1 byte modelId + 1 byte functionId + 1 byte checksumm
-	uint8_t messageToSend[messageSize];
-	//fill message
-	messageToSend[0] = (uint8_t)modelId;
-	messageToSend[1] = (uint8_t)functionId;
-	if(payload != NULL && payloadLength != 0)
-		memcpy((void*)(messageToSend + 2), payload, payloadLength);
-		
-	messageToSend[messageSize - 1] = getChecksum(messageToSend, messageSize - 1);//last byte is a checksum	
-	midiSendSysExManfId(FRACTAL_AUDIO_MANF_ID, messageSize, messageToSend);
+	mappingModelId = modelId;
+}
+
+void axefxSendMappedParameter(uint16_t param, uint16_t value)
+{
+	axefxSendSetParameter(mappingModelId, param >> 8, param & 0xFF, value);
 }
 
 void axefxParseTunerInfo(AxeFxEffectTunerInfo* tunerInfo, uint8_t* sysEx)
@@ -116,6 +116,30 @@ typedef struct AxeFxMultipurposeResponseInfo
  */ 
 void axefxSendFunctionRequest(AxeFxModelId modelId, AxeFxFunctionId functionId, uint8_t* payload, uint16_t payloadLength);
 
+/*
+ * @brief	Set effect parameter value (AXEFX_GET_SET_PARAMETER function in AxeFx II format)
+ * @param	modelId -		AxeFx model ID. See AxeFxModelId enum
+ * @param	effectId -		effect block ID
+ * @param	paramId -		parameter ID in effect block
+ * @param	value -			parameter value, 0..65534
+ */
+void axefxSendSetParameter(AxeFxModelId modelId, uint16_t effectId, uint16_t paramId, uint16_t value);
+
+//Parameter address for expression pedal mapping, see expression.h. Effect ID and parameter ID must be less than 256
+#define AXEFX_MAPPING_PARAM(effectId, paramId) ((uint16_t)(((effectId) << 8) | (paramId)))
+
+/*
+ * @brief	Set model ID used by axefxSendMappedParameter(). Default is AXEFX_2_MODEL
+ */
+void axefxSetMappingModel(AxeFxModelId modelId);
+
+/*
+ * @brief	Sender for EXP_TARGET_AXEFX pedal mapping targets. Register it by expRegisterMappingSender()
+ * @param	param -		AXEFX_MAPPING_PARAM(effectId, paramId)
+ * @param	value -		parameter value, 0..65534
+ */
+void axefxSendMappedParameter(uint16_t param, uint16_t value);
+
 
 /*
  * @brief	Parse SysEx message and fill tunerInfo structure, if SysEx is valid AXEFX_TUNER_INFO message
@@ -11,234 +11,210 @@
 
 #include "kpa.h"
 #include "midi.h"
-#include <avr/pgmspace.h>
+#include "timer.h"
 #include <string.h>
 
-//fill first 6 bytes of message
-static void fillMessageCommonPart(uint8_t* messageToSend, uint8_t function, KpaParamAddress controllerAddr)
+//Offsets of data in received SysEx, manufacturer id included
+#define KPA_FUNCTION_CODE_OFFSET 6
+#define KPA_PARAM_ADDR_OFFSET 8
+#define KPA_PARAM_VALUE_OFFSET 10
+#define KPA_PARAM_EXT_VALUE_OFFSET 13
+#define KPA_ACTIVE_SENSING_COUNTER_OFFSET 9
+
+//State mirror
+#define KPA_STATE_EMPTY 0xFFFF//address bytes are 7-bit, so it never matches real parameter
+#define KPA_STATE_FLAGS_SIZE ((KPA_STATE_TABLE_SIZE + 7) / 8)
+
+#if (KPA_STATE_TABLE_SIZE & (KPA_STATE_TABLE_SIZE - 1)) != 0
+#error KPA_STATE_TABLE_SIZE must be power of two
+#endif
+
+typedef struct KpaStateEntry
+{
+	KpaParamAddress addr_;
+	uint16_t value_;
+}KpaStateEntry;
+
+static KpaStateEntry stateTable[KPA_STATE_TABLE_SIZE];
+static uint8_t stateKnown[KPA_STATE_FLAGS_SIZE];//bit is set if value is received
+static uint8_t stateChanged[KPA_STATE_FLAGS_SIZE];//bit is set if value is changed and not taken yet
+static uint8_t stateWatched;
+static bool stateInitialized;
+
+//Connection manager
+typedef enum KpaConnectionState
 {
-		messageToSend[0] = (uint8_t)KPA_PRODUCT_TYPE;
-		messageToSend[1] = (uint8_t)KPA_DEVICE_ID_OMNI;
+	KPA_CONNECTION_IDLE = 0,	//manager is not started
+	KPA_CONNECTION_DISCONNECTED,
+	KPA_CONNECTION_NAME_SENT,
+	KPA_CONNECTION_WAIT_SENSING,
+	KPA_CONNECTION_CONNECTED
+}KpaConnectionState;
+
+static KpaConnectionState connectionState;
+static uint8_t connectionSet;
+static uint8_t connectionFlags;
+static const char* connectionName;
+static void (*connectionCallback)(bool connected);
+static uint32_t connectionTime;//time of last state change or retry
+static uint32_t sensingTime;//time of last active sensing SysEx
+static uint32_t renewTime;//time of last beacon
+static uint8_t sensingCounter;
+static bool activeSenseReceived;
+static bool resyncRequested;//sensing message is lost, full set should be requested again
+
+//start message and send first 6 bytes: product, device, function, instance and address
+static void beginMessage(uint8_t function, KpaParamAddress controllerAddr)
+{
+	midiSysExBegin((uint32_t)KEMPER_AMPS_MANF_ID);
+	midiSysExPut((uint8_t)KPA_PRODUCT_TYPE);
+	midiSysExPut((uint8_t)KPA_DEVICE_ID_OMNI);
 
-		//function
-		messageToSend[2] = (uint8_t)function;
-		messageToSend[3] = (uint8_t)KPA_PARAMETER_INSTANCE;
-		
-		//address
-		messageToSend[4] = (uint8_t)(controllerAddr >> 8);
-		messageToSend[5] = (uint8_t)controllerAddr;
+	//function
+	midiSysExPut(function);
+	midiSysExPut((uint8_t)KPA_PARAMETER_INSTANCE);
+	
+	//address
+	midiSysExPut((uint8_t)(controllerAddr >> 8));
+	midiSysExPut((uint8_t)controllerAddr);
 }
 
-//fill first 9 bytes of extended message
-static void fillExtMessageCommonPart(uint8_t* messageToSend, uint8_t function, KpaParamExtAddress controllerAddr)
+//start extended message and send first 9 bytes
+static void beginExtMessage(uint8_t function, KpaParamExtAddress controllerAddr)
 {
-	messageToSend[0] = (uint8_t)KPA_PRODUCT_TYPE;
-	messageToSend[1] = (uint8_t)KPA_DEVICE_ID_OMNI;
+	midiSysExBegin((uint32_t)KEMPER_AMPS_MANF_ID);
+	midiSysExPut((uint8_t)KPA_PRODUCT_TYPE);
+	midiSysExPut((uint8_t)KPA_DEVICE_ID_OMNI);
 
 	//function
-	messageToSend[2] = (uint8_t)function;
-	messageToSend[3] = (uint8_t)KPA_PARAMETER_INSTANCE;
+	midiSysExPut(function);
+	midiSysExPut((uint8_t)KPA_PARAMETER_INSTANCE);
 	
 	//address
-	messageToSend[4] = (uint8_t)(controllerAddr >> 32);
-	messageToSend[5] = (uint8_t)(controllerAddr >> 24);
-	messageToSend[6] = (uint8_t)(controllerAddr >> 16);
-	messageToSend[7] = (uint8_t)(controllerAddr >> 8);
-	messageToSend[8] = (uint8_t)controllerAddr;
+	midiSysExPut((uint8_t)(controllerAddr >> 32));
+	midiSysExPut((uint8_t)(controllerAddr >> 24));
+	midiSysExPut((uint8_t)(controllerAddr >> 16));
+	midiSysExPut((uint8_t)(controllerAddr >> 8));
+	midiSysExPut((uint8_t)controllerAddr);
 }
 
-static const uint8_t singleParamChangeMessSize PROGMEM = 8;
 void kpaSendSingleParameterChange(KpaParamAddress controllerAddr, uint16_t value)
 {
-	size_t baseMessLength = pgm_read_byte(&singleParamChangeMessSize);
-	uint8_t messageToSend[baseMessLength];
-
-	//fill first 6 bytes
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_SINGLE_PARAMETER_CHANGE, controllerAddr);
-	//value
-	messageToSend[6] = ((uint8_t)(value >> 7)) & 0x7F;
-	messageToSend[7] = ((uint8_t)value) & 0x7F;
-		
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength, messageToSend);
+	beginMessage(KPA_FUNCTION_SINGLE_PARAMETER_CHANGE, controllerAddr);
+	midiSysExPut14(value);
+	midiSysExEnd();
 }
 
-static const uint8_t multiParamChangeMessSize PROGMEM = 6;
 void kpaSendMultiParameterChange(KpaParamAddress controllerAddr, uint16_t* value, uint8_t num)
 {
-	size_t baseMessLength = pgm_read_byte(&multiParamChangeMessSize);
-	uint8_t messageToSend[baseMessLength + num*sizeof(uint16_t)];
 	uint8_t i;
-	uint16_t tmpValue;
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_MULTI_PARAMETER_CHANGE, controllerAddr);
 	
-	//value
+	beginMessage(KPA_FUNCTION_MULTI_PARAMETER_CHANGE, controllerAddr);
 	for(i = 0; i < num; ++i)
-	{
-		tmpValue = *(value + i);
-		messageToSend[baseMessLength + i*sizeof(uint16_t)] = ((uint8_t)(tmpValue >> 7)) & 0x7F;
-		messageToSend[baseMessLength + 1 + i*sizeof(uint16_t)] = ((uint8_t)tmpValue) & 0x7F;
-	}
-	
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, pgm_read_byte(&multiParamChangeMessSize) + num*sizeof(uint16_t), messageToSend);	
+		midiSysExPut14(*(value + i));
+	midiSysExEnd();
 }
 
-static const uint8_t stringParamChangeMessSize PROGMEM = 6;
 void kpaSendStringParameterChange(KpaParamAddress controllerAddr, const char* str)
 {
-	size_t strLength = strlen(str);
-	size_t baseMessLength = pgm_read_byte(&stringParamChangeMessSize);
-	uint8_t messageToSend[baseMessLength + strLength + 1];
-
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_STRING_PARAMETER_CHANGE, controllerAddr);
-
-	memcpy(messageToSend + baseMessLength, str, strLength);
-	messageToSend[baseMessLength + strLength] = 0;
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength + strLength + 1, messageToSend);
+	beginMessage(KPA_FUNCTION_STRING_PARAMETER_CHANGE, controllerAddr);
+	midiSysExPutString(str);
+	midiSysExEnd();
 }
 
-static const uint8_t blobParamChangeMessSize PROGMEM = 10;
 void kpaSendBLOBChange(KpaParamAddress controllerAddr, uint16_t startOffset, uint8_t* content, uint16_t size)
 {
-	const size_t baseMessLength = pgm_read_byte(&blobParamChangeMessSize);
-	uint8_t messageToSend[baseMessLength + size];
-	
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_BLOB, controllerAddr);
-
-	//offset
-	messageToSend[6] = ((uint8_t)(startOffset >> 7)) & 0x7F;
-	messageToSend[7] = ((uint8_t)startOffset) & 0x7F;
-		
-	//size
-	messageToSend[8] = ((uint8_t)(size >> 7)) & 0x7F;
-	messageToSend[9] = ((uint8_t)size) & 0x7F;
-	
-	//data
-	memcpy(messageToSend + baseMessLength, content, size);
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength + size, messageToSend);
+	beginMessage(KPA_FUNCTION_BLOB, controllerAddr);
+	midiSysExPut14(startOffset);
+	midiSysExPut14(size);
+	midiSysExPutBlock(content, size);
+	midiSysExEnd();
 }
 
-static const uint8_t extParamChangeMessSize PROGMEM = 9;
 void kpaSendExtendedParameterChange(KpaParamExtAddress controllerAddr, uint32_t* value, uint8_t num)
 {
-	const size_t baseMessLength = pgm_read_byte(&extParamChangeMessSize);
-	uint8_t messageToSend[baseMessLength + num*5];
 	uint8_t i;
-	//fill message
-	fillExtMessageCommonPart(messageToSend, KPA_FUNCTION_EXTENDED_PARAMETER_CHANGE, controllerAddr);
-	
-	//value
 	uint32_t tmpValue;
 
+	beginExtMessage(KPA_FUNCTION_EXTENDED_PARAMETER_CHANGE, controllerAddr);
 	for(i = 0; i < num; ++i)
 	{
 		tmpValue = *(value + i);
-		messageToSend[baseMessLength + i*5] = ((uint8_t)(tmpValue >> 28)) & 0x0F;
-		messageToSend[baseMessLength + 1 + i*5] = ((uint8_t)(tmpValue >> 21)) & 0x7F;
-		messageToSend[baseMessLength + 2 + i*5] = ((uint8_t)(tmpValue >> 14)) & 0x7F;
-		messageToSend[baseMessLength + 3 + i*5] = ((uint8_t)(tmpValue >> 7)) & 0x7F;
-		messageToSend[baseMessLength + 4 + i*5] = ((uint8_t)tmpValue) & 0x7F;
+		midiSysExPut(((uint8_t)(tmpValue >> 28)) & 0x0F);
+		midiSysExPut(((uint8_t)(tmpValue >> 21)) & 0x7F);
+		midiSysExPut(((uint8_t)(tmpValue >> 14)) & 0x7F);
+		midiSysExPut14((uint16_t)tmpValue);
 	}
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength + num*5, messageToSend);	
+	midiSysExEnd();
 }
 
-static const uint8_t extStringParamChangeMessSize PROGMEM = 9;
 void kpaSendExtendedStringParameterChange(KpaParamExtAddress controllerAddr, char* str)
 {
-	size_t baseMessLength = pgm_read_byte(&extStringParamChangeMessSize);
-	size_t strLength = strlen(str);
-	uint8_t messageToSend[baseMessLength + strLength + 1];
-
-	fillExtMessageCommonPart(messageToSend, KPA_FUNCTION_EXTENDED_STRING_PARAMETER_CHANGE, controllerAddr);
-
-	memcpy(messageToSend + baseMessLength, str, strLength);
-	messageToSend[baseMessLength + strLength] = 0;
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength + strLength + 1, messageToSend);
+	beginExtMessage(KPA_FUNCTION_EXTENDED_STRING_PARAMETER_CHANGE, controllerAddr);
+	midiSysExPutString(str);
+	midiSysExEnd();
 }
 
-static const uint8_t rqSingleParameterValueMessSize PROGMEM = 6;
 void kpaSendRequestSingleParameterValue(KpaParamAddress controllerAddr)
 {
-	const size_t baseMessLength = pgm_read_byte(&rqSingleParameterValueMessSize);
-	uint8_t messageToSend[baseMessLength];
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_REQUEST_SINGLE_PARAMETER_VALUE, controllerAddr);
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength, messageToSend);	
+	beginMessage(KPA_FUNCTION_REQUEST_SINGLE_PARAMETER_VALUE, controllerAddr);
+	midiSysExEnd();
 }
 
-static const uint8_t rqMultiParameterValueMessSize PROGMEM = 6;
 void kpaSendRequestMultiParameterValues(KpaParamAddress controllerAddr)
 {
-	const size_t baseMessLength = pgm_read_byte(&rqMultiParameterValueMessSize);
-	uint8_t messageToSend[baseMessLength];
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_REQUEST_MULTI_PARAMETER_VALUES, controllerAddr);
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength, messageToSend);	
+	beginMessage(KPA_FUNCTION_REQUEST_MULTI_PARAMETER_VALUES, controllerAddr);
+	midiSysExEnd();
 }
 
-static const uint8_t rqStringParameterValueMessSize PROGMEM = 6;
 void kpaSendRequestStringParameter(KpaParamAddress controllerAddr)
 {
-	const size_t baseMessLength = pgm_read_byte(&rqStringParameterValueMessSize);
-	uint8_t messageToSend[baseMessLength];
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_REQUEST_STRING_PARAMETER, controllerAddr);
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength, messageToSend);	
+	beginMessage(KPA_FUNCTION_REQUEST_STRING_PARAMETER, controllerAddr);
+	midiSysExEnd();
 }
 
-static const uint8_t rqExtStringParameterValueMessSize PROGMEM = 9;
 void kpaSendRequestExtendedStringParameter(KpaParamExtAddress controllerAddr)
 {
-	const size_t baseMessLength = pgm_read_byte(&rqExtStringParameterValueMessSize);
-	uint8_t messageToSend[baseMessLength];
-	fillExtMessageCommonPart(messageToSend, KPA_FUNCTION_REQUEST_EXTENDED_STRING_PARAMETER, controllerAddr);
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength, messageToSend);	
+	beginExtMessage(KPA_FUNCTION_REQUEST_EXTENDED_STRING_PARAMETER, controllerAddr);
+	midiSysExEnd();
 }
 
-static const uint8_t rqParameterValueAsStringMessSize PROGMEM = 8;
 void kpaSendRequestParameterValueAsRenderedString(KpaParamAddress controllerAddr, uint16_t value)
 {
-	const size_t baseMessLength = pgm_read_byte(&rqParameterValueAsStringMessSize);
-	uint8_t messageToSend[baseMessLength];
-	fillMessageCommonPart(messageToSend, KPA_FUNCTION_REQUEST_PARAMETER_VALUE_AS_RENDERED_STRING, controllerAddr);
-	
-	messageToSend[6] = ((uint8_t)(value >> 7)) & 0x7F;
-	messageToSend[7] = ((uint8_t)value) & 0x7F;
-		
-	midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength, messageToSend);	
+	beginMessage(KPA_FUNCTION_REQUEST_PARAMETER_VALUE_AS_RENDERED_STRING, controllerAddr);
+	midiSysExPut14(value);
+	midiSysExEnd();
 }
 
-static const uint8_t beaconMessSize PROGMEM = 8;
 void kpaSendBeacon(uint8_t setNum, uint8_t flags, uint8_t timeLease)
 {
-		const size_t baseMessLength = pgm_read_byte(&beaconMessSize);
-		uint8_t messageToSend[baseMessLength];
-		
-		//KPA_FUNCTION_SYS_COMMUNICATION function have special 1 bytes parameter address
-		//Don't want to implement separate helper for this single case
-		messageToSend[0] = (uint8_t)KPA_PRODUCT_TYPE;
-		messageToSend[1] = (uint8_t)KPA_DEVICE_ID_OMNI;
-
-		//function
-		messageToSend[2] = (uint8_t)KPA_FUNCTION_SYS_COMMUNICATION;
-		messageToSend[3] = (uint8_t)KPA_PARAMETER_INSTANCE;
-				
-		//address
-		messageToSend[4] = (uint8_t)KPA_PARAM_BEACON;
-				
-		messageToSend[5] = setNum;
-		messageToSend[6] = flags;
-		messageToSend[7] = timeLease;
-		
-		midiSendSysExManfId((uint32_t)KEMPER_AMPS_MANF_ID, baseMessLength, messageToSend);
+	//KPA_FUNCTION_SYS_COMMUNICATION function have special 1 bytes parameter address
+	//Don't want to implement separate helper for this single case
+	midiSysExBegin((uint32_t)KEMPER_AMPS_MANF_ID);
+	midiSysExPut((uint8_t)KPA_PRODUCT_TYPE);
+	midiSysExPut((uint8_t)KPA_DEVICE_ID_OMNI);
+
+	//function
+	midiSysExPut((uint8_t)KPA_FUNCTION_SYS_COMMUNICATION);
+	midiSysExPut((uint8_t)KPA_PARAMETER_INSTANCE);
+	
+	//address
+	midiSysExPut((uint8_t)KPA_PARAM_BEACON);
+	
+	midiSysExPut(setNum);
+	midiSysExPut(flags);
+	midiSysExPut(timeLease);
+	midiSysExEnd();
 }
 
-static const uint8_t functionCodeOffset PROGMEM = 6;
 uint8_t kpaGetFunction(uint8_t* sysEx)
 {
-	return *(sysEx + pgm_read_byte(&functionCodeOffset));
+	return *(sysEx + KPA_FUNCTION_CODE_OFFSET);
 }
 
-static const uint8_t paramAddrOffset PROGMEM = 8;
 KpaParamAddress kpaGetParamAddress(uint8_t* sysEx)
 {
-	return (*(sysEx + pgm_read_byte(&paramAddrOffset)) << 8) | *(sysEx + pgm_read_byte(&paramAddrOffset) + 1); 
+	return (*(sysEx + KPA_PARAM_ADDR_OFFSET) << 8) | *(sysEx + KPA_PARAM_ADDR_OFFSET + 1); 
 }
 
 KpaParamExtAddress kpaGetParamExtAddress(uint8_t* sysEx)
@@ -247,7 +223,7 @@ KpaParamExtAddress kpaGetParamExtAddress(uint8_t* sysEx)
 	KpaParamExtAddress retVal = 0;
 	for(i = 0; i < 5; ++i)
 	{
-		retVal |= *(sysEx + pgm_read_byte(&paramAddrOffset) + i);
+		retVal |= *(sysEx + KPA_PARAM_ADDR_OFFSET + i);
 		if (i !=4)
 			retVal <<= 8;
 	}
@@ -255,15 +231,14 @@ KpaParamExtAddress kpaGetParamExtAddress(uint8_t* sysEx)
 	return retVal;
 }
 
-static const uint8_t paramValueOffset PROGMEM = 10;
 uint16_t kpaGetSingleParameterValue(uint8_t* sysEx)
 {
-	return (*(sysEx + pgm_read_byte(&paramValueOffset)) << 7) | *(sysEx + pgm_read_byte(&paramValueOffset) + 1); 
+	return (*(sysEx + KPA_PARAM_VALUE_OFFSET) << 7) | *(sysEx + KPA_PARAM_VALUE_OFFSET + 1); 
 }
 
 bool kpaGetMultiParameterValue(uint8_t valueNum, uint16_t* userBuffer, uint8_t* sysEx)
 {
-	uint16_t offset = pgm_read_byte(&paramValueOffset) + valueNum*2;
+	uint16_t offset = KPA_PARAM_VALUE_OFFSET + valueNum*2;
 	if (offset <= (midiGetSysExLength(sysEx) - 2)) 
 	{
 		*userBuffer = (*(sysEx + offset) << 7) | *(sysEx + offset + 1);
@@ -283,15 +258,14 @@ uint16_t kpaGetAllMultiParameterValues(uint16_t* userBuffer, uint8_t* sysEx)
 
 void kpaGetStringParameter(char* str, uint8_t maxSize, uint8_t* sysEx)
 {
-	strncpy(str, (char*)(sysEx + pgm_read_byte(&paramValueOffset)), maxSize);
+	strncpy(str, (char*)(sysEx + KPA_PARAM_VALUE_OFFSET), maxSize);
 	*(str + maxSize - 1) = '\0';
 }
 
 //Extended parameters
-static const uint8_t paramExtValueOffset PROGMEM = 13;
 bool kpaGetMultiExtParameterValue(uint8_t valueNum, uint32_t* userBuffer, uint8_t* sysEx)
 {
-	uint16_t offset = pgm_read_byte(&paramExtValueOffset) + valueNum*5;
+	uint16_t offset = KPA_PARAM_EXT_VALUE_OFFSET + valueNum*5;
 	uint8_t i = 0;
 
 	if (offset <= (midiGetSysExLength(sysEx) - 5))
@@ -315,14 +289,275 @@ uint16_t kpaGetAllMultiExtParameterValues(uint32_t* userBuffer, uint8_t* sysEx)
 
 void kpaGetExtStringParameter(char* str, uint8_t maxSize, uint8_t* sysEx)
 {
-	strncpy(str, (char*)(sysEx + pgm_read_byte(&paramExtValueOffset)), maxSize);
+	strncpy(str, (char*)(sysEx + KPA_PARAM_EXT_VALUE_OFFSET), maxSize);
 	*(str + maxSize - 1) = '\0';
 }
 
-static const uint8_t activeSensingCounterValueOffset PROGMEM = 9;
 uint8_t kpaGetActiveSensingCounter(uint8_t* sysEx)
 {
-	return *(sysEx + pgm_read_byte(&activeSensingCounterValueOffset));
+	return *(sysEx + KPA_ACTIVE_SENSING_COUNTER_OFFSET);
+}
+
+//Page and offset are mixed, so parameters from the same page are spread over table
+static inline uint8_t stateHash(KpaParamAddress addr)
+{
+	return ((uint8_t)addr ^ (uint8_t)(addr >> 8) ^ (uint8_t)(addr >> 4)) & (KPA_STATE_TABLE_SIZE - 1);
+}
+
+static void stateInit()
+{
+	uint8_t i;
+	
+	for(i = 0; i < KPA_STATE_TABLE_SIZE; ++i)
+		stateTable[i].addr_ = KPA_STATE_EMPTY;
+	stateInitialized = true;
+}
+
+//return index of entry or KPA_STATE_TABLE_SIZE if address is not watched
+static uint8_t stateFind(KpaParamAddress addr)
+{
+	uint8_t index = stateHash(addr);
+	uint8_t i;
+	
+	if(!stateInitialized)
+		return KPA_STATE_TABLE_SIZE;
+	
+	//table is never full, so empty entry stops probing
+	for(i = 0; i < KPA_STATE_TABLE_SIZE; ++i)
+	{
+		if(stateTable[index].addr_ == addr)
+			return index;
+		if(stateTable[index].addr_ == KPA_STATE_EMPTY)
+			break;
+		index = (index + 1) & (KPA_STATE_TABLE_SIZE - 1);
+	}
+	return KPA_STATE_TABLE_SIZE;
+}
+
+static bool stateUpdate(KpaParamAddress addr, uint16_t value)
+{
+	uint8_t index = stateFind(addr);
+	uint8_t mask;
+	
+	if(index == KPA_STATE_TABLE_SIZE)
+		return false;
+	
+	mask = 1 << (index & 0x07);
+	if((stateKnown[index >> 3] & mask) && stateTable[index].value_ == value)
+		return false;
+	
+	stateTable[index].value_ = value;
+	stateKnown[index >> 3] |= mask;
+	stateChanged[index >> 3] |= mask;
+	return true;
+}
+
+bool kpaStateWatch(KpaParamAddress addr)
+{
+	uint8_t index;
+	
+	if(!stateInitialized)
+		stateInit();
+	
+	if(stateFind(addr) != KPA_STATE_TABLE_SIZE)
+		return true;
+	
+	//keep at least one empty entry, it terminates probing
+	if(stateWatched >= KPA_STATE_TABLE_SIZE - 1)
+		return false;
+	
+	index = stateHash(addr);
+	while(stateTable[index].addr_ != KPA_STATE_EMPTY)
+		index = (index + 1) & (KPA_STATE_TABLE_SIZE - 1);
+	
+	stateTable[index].addr_ = addr;
+	++stateWatched;
+	return true;
+}
+
+static void connectionSensing(uint8_t counter)
+{
+	if(connectionState == KPA_CONNECTION_WAIT_SENSING)
+	{
+		connectionState = KPA_CONNECTION_CONNECTED;
+		if(connectionCallback != NULL)
+			connectionCallback(true);
+	}
+	else if(connectionState == KPA_CONNECTION_CONNECTED)
+	{
+		if(counter != ((sensingCounter + 1) & 0x7F))
+			resyncRequested = true;
+	}
+	else
+		return;
+	
+	sensingCounter = counter;
+	sensingTime = getMillis();
+}
+
+bool kpaProcessSysEx(uint8_t* sysEx)
+{
+	KpaParamAddress addr;
+	uint16_t value;
+	uint8_t i;
+	bool updated = false;
+	
+	if(midiGetSysExManufacturerId(sysEx) != KEMPER_AMPS_MANF_ID)
+		return false;
+	
+	switch(kpaGetFunction(sysEx))
+	{
+		case KPA_FUNCTION_SYS_COMMUNICATION:
+			if(*(sysEx + KPA_PARAM_ADDR_OFFSET) == KPA_PARAM_ACTIVE_SENSING_SIGNAL)
+				connectionSensing(kpaGetActiveSensingCounter(sysEx));
+			break;
+		
+		case KPA_FUNCTION_SINGLE_PARAMETER_CHANGE:
+			updated = stateUpdate(kpaGetParamAddress(sysEx), kpaGetSingleParameterValue(sysEx));
+			break;
+		
+		case KPA_FUNCTION_MULTI_PARAMETER_CHANGE:
+			//each next value belongs to the next address, offset is 7-bit
+			addr = kpaGetParamAddress(sysEx);
+			for(i = 0; kpaGetMultiParameterValue(i, &value, sysEx); ++i)
+			{
+				if(stateUpdate(addr, value))
+					updated = true;
+				addr = ((addr & 0x7F) == 0x7F) ? addr + 0x81 : addr + 1;
+			}
+			break;
+		
+		default:
+			break;
+	}
+	return updated;
+}
+
+bool kpaStateGet(KpaParamAddress addr, uint16_t* value)
+{
+	uint8_t index = stateFind(addr);
+	
+	if(index == KPA_STATE_TABLE_SIZE || !(stateKnown[index >> 3] & (1 << (index & 0x07))))
+		return false;
+	
+	*value = stateTable[index].value_;
+	return true;
 }
 
+void kpaStateSet(KpaParamAddress addr, uint16_t value)
+{
+	stateUpdate(addr, value);
+}
 
+bool kpaStateTakeChanged(KpaParamAddress addr)
+{
+	uint8_t index = stateFind(addr);
+	uint8_t mask;
+	
+	if(index == KPA_STATE_TABLE_SIZE)
+		return false;
+	
+	mask = 1 << (index & 0x07);
+	if(!(stateChanged[index >> 3] & mask))
+		return false;
+	
+	stateChanged[index >> 3] &= ~mask;
+	return true;
+}
+
+bool kpaStateAnyChanged()
+{
+	uint8_t i;
+	
+	for(i = 0; i < KPA_STATE_FLAGS_SIZE; ++i)
+	{
+		if(stateChanged[i])
+			return true;
+	}
+	return false;
+}
+
+static void connectionActiveSense()
+{
+	activeSenseReceived = true;
+}
+
+static void connectionSendBeacon(bool init)
+{
+	uint8_t flags = connectionFlags;
+	if(init)
+		flags |= KPA_BEACON_FLAG_INIT;
+	
+	kpaSendBeacon(connectionSet, flags, KPA_CONNECTION_LEASE);
+	renewTime = getMillis();
+	resyncRequested = false;
+}
+
+void kpaConnectionStart(uint8_t setNum, uint8_t flags, const char* boardName, void (*callback)(bool connected))
+{
+	connectionSet = setNum;
+	connectionFlags = flags & ~(KPA_BEACON_FLAG_NOCTR | KPA_BEACON_FLAG_INIT);
+	connectionName = boardName;
+	connectionCallback = callback;
+	connectionState = KPA_CONNECTION_DISCONNECTED;
+	connectionTime = getMillis();
+	activeSenseReceived = false;
+	
+	midiRegisterActiveSenseCallback(connectionActiveSense);
+}
+
+void kpaConnectionProcess()
+{
+	uint32_t now = getMillis();
+	
+	switch(connectionState)
+	{
+		case KPA_CONNECTION_DISCONNECTED:
+			if(!activeSenseReceived && now - connectionTime < KPA_CONNECTION_RETRY_MS)
+				break;
+			
+			activeSenseReceived = false;
+			//If you want to KPA show a popup with the your floorboard name when the first beacon message received
+			//string change with KPA_PARAM_FLOORBOARD_NAME address should be sent before beacon
+			if(connectionName != NULL)
+				kpaSendStringParameterChange(KPA_PARAM_FLOORBOARD_NAME, connectionName);
+			connectionState = KPA_CONNECTION_NAME_SENT;
+			connectionTime = now;
+			break;
+		
+		case KPA_CONNECTION_NAME_SENT:
+			if(now - connectionTime < KPA_CONNECTION_NAME_PAUSE_MS)
+				break;
+			
+			connectionSendBeacon(true);
+			connectionState = KPA_CONNECTION_WAIT_SENSING;
+			connectionTime = now;
+			sensingTime = now;
+			break;
+		
+		case KPA_CONNECTION_WAIT_SENSING:
+		case KPA_CONNECTION_CONNECTED:
+			if(now - sensingTime >= KPA_CONNECTION_SENSING_TIMEOUT_MS)
+			{
+				if(connectionState == KPA_CONNECTION_CONNECTED && connectionCallback != NULL)
+					connectionCallback(false);
+				connectionState = KPA_CONNECTION_DISCONNECTED;
+				connectionTime = now;
+				break;
+			}
+			
+			if(resyncRequested)
+				connectionSendBeacon(true);
+			else if(now - renewTime >= KPA_CONNECTION_RENEW_MS)
+				connectionSendBeacon(false);
+			break;
+		
+		default:
+			break;
+	}
+}
+
+bool kpaIsConnected()
+{
+	return connectionState == KPA_CONNECTION_CONNECTED;
+}
@@ -237,6 +237,52 @@ void kpaGetExtStringParameter(char* str, uint8_t maxSize, uint8_t* sysEx);
  */
 uint8_t kpaGetActiveSensingCounter(uint8_t* sysEx);
 
+//Parameter state mirror
+//Latest values of watched parameters are stored in open addressing hash table,
+//lookup by address takes constant time. Must be power of two and greater than number of watched parameters
+#define KPA_STATE_TABLE_SIZE 16
+
+/*
+ * @brief	Add parameter to state mirror. Value is unknown until KPA sends it or kpaStateSet is called
+ * @param	addr -	parameter address
+ * @return	false if table is full
+ */
+bool kpaStateWatch(KpaParamAddress addr);
+
+/*
+ * @brief	Update state mirror from received SysEx message. Single and multi parameter changes
+ *			of watched parameters are stored, others are ignored. Active sensing is passed to connection manager.
+ *			Call it from SysEx callback
+ * @param	*sysEx -	pointer to SysEx message
+ * @return	true if any watched parameter is updated
+ */
+bool kpaProcessSysEx(uint8_t* sysEx);
+
+/*
+ * @brief	Get latest value of watched parameter
+ * @param	addr -		parameter address
+ * @param	*value -	pointer to user variable for value
+ * @return	false if parameter is not watched or value is unknown yet
+ */
+bool kpaStateGet(KpaParamAddress addr, uint16_t* value);
+
+/*
+ * @brief	Set value of watched parameter locally, e.g. after sending it to KPA. Change flag is set if value differs
+ */
+void kpaStateSet(KpaParamAddress addr, uint16_t value);
+
+/*
+ * @brief	Check and clear change flag of watched parameter. 
+ *			Use it to refresh only LEDs and LCD fields which depend on changed parameter
+ * @return	true if value is changed since last call
+ */
+bool kpaStateTakeChanged(KpaParamAddress addr);
+
+/*
+ * @brief	Check if any watched parameter is changed. Flags are not cleared
+ */
+bool kpaStateAnyChanged();
+
 
 //Beacon flags
 #define KPA_BEACON_FLAG_INIT        0x01//If the set should be initially sent after enabling the bidirectional mode
@@ -246,6 +292,40 @@ uint8_t kpaGetActiveSensingCounter(uint8_t* sysEx);
 #define KPA_BEACON_FLAG_NOCTR       0x10//if set, the KPA will not send back the periodic KPA_PARAM_ACTIVE_SENSING_SIGNAL
 #define KPA_BEACON_FLAG_TUNEMODE    0x20//if set, the Tuning information is only sent in Tuner Mode, otherwise it's being sent all the time
 
+//Connection manager
+//Beacon is sent with finite time lease and renewed at half of lease time.
+//Connection is checked by "active sensing" SysEx which KPA sends every KPA_SENSING_PERIOD_MS
+#define KPA_CONNECTION_LEASE				5		//beacon time lease, units of 2 seconds
+#define KPA_CONNECTION_RENEW_MS				((uint32_t)KPA_CONNECTION_LEASE * 1000)
+#define KPA_SENSING_PERIOD_MS				500
+#define KPA_CONNECTION_SENSING_TIMEOUT_MS	(KPA_SENSING_PERIOD_MS * 3 / 2)//lost connection is detected within one period after missed message
+#define KPA_CONNECTION_RETRY_MS				1000	//beacon resend period while KPA not responds
+#define KPA_CONNECTION_NAME_PAUSE_MS		100		//pause between floorboard name and beacon
+
+/*
+ * @brief	Start connection manager. Connection is established as soon as KPA sends MIDI active sensing (0xFE)
+ *			or after KPA_CONNECTION_RETRY_MS. Manager registers midi active sense callback, so don't register your own.
+ *			Requires initTimer(). Received SysEx must be passed to kpaProcessSysEx()
+ * @param	setNum -	set of parameters to be sent back, see kpaSendBeacon
+ * @param	flags -		beacon flags, see KPA_BEACON_FLAG_... KPA_BEACON_FLAG_NOCTR is ignored, manager needs sensing.
+ *						KPA_BEACON_FLAG_INIT is used only for the first beacon and after lost sensing messages
+ * @param	*boardName - floorboard name to show on KPA when connected, may be NULL. String must be valid while manager runs
+ * @param	callback -	invoked from kpaConnectionProcess when connection is established(true) or lost(false). May be NULL
+ */
+void kpaConnectionStart(uint8_t setNum, uint8_t flags, const char* boardName, void (*callback)(bool connected));
+
+/*
+ * @brief	Connection manager routine: sends and renews beacon, checks sensing timeout. 
+ *			Never blocks, should be invoked in main loop
+ */
+void kpaConnectionProcess();
+
+/*
+ * @brief	Get connection state
+ * @return	true if KPA responds with active sensing
+ */
+bool kpaIsConnected();
+
 
 //KPA functions code
 #define KPA_FUNCTION_SINGLE_PARAMETER_CHANGE					0x01